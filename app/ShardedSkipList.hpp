@@ -0,0 +1,546 @@
+#ifndef ___SHARDED_SKIP_LIST_HPP
+#define ___SHARDED_SKIP_LIST_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "SkipList.hpp"
+#include "runtimeexcept.hpp"
+
+// A set of SkipLists, each owning a contiguous key range.
+//
+//   shard 0: (-inf, b1)   shard 1: [b1, b2)   ...   shard n-1: [b(n-1), inf)
+//
+// Operations are routed to a shard by binary search over the boundaries and
+// only lock that shard, so writers to different ranges do not contend.
+//
+// The routing table is immutable: a split or merge builds a new one and
+// publishes it with a single pointer store, so routing takes no lock that
+// every thread shares. A reader only announces itself in one of several
+// per-thread slots, each on its own cache line, and a retired table is
+// freed once every reader that might still hold it has left (epoch-based
+// reclamation). Each shard also records the range it owns, so a reader
+// routed by a table that has just been replaced notices, after locking the
+// shard, that the key has moved on and routes again.
+template<typename Key, typename Value>
+class ShardedSkipList
+{
+
+private:
+
+	class Shard
+	{
+
+	public:
+
+		SkipList<Key, Value> list;
+		mutable std::shared_mutex lock;
+		mutable std::atomic<size_t> hits;
+		// The range this shard owns, guarded by *lock*. The first shard is
+		// unbounded below and the last one above; a merged-away shard owns
+		// nothing.
+		Key lowerBound;
+		Key upperBound;
+		bool boundedBelow;
+		bool boundedAbove;
+		bool retired;
+
+		Shard():
+		hits(0),
+		boundedBelow(false),
+		boundedAbove(false),
+		retired(false)
+		{
+
+		}
+
+		bool owns(const Key & k) const
+		{
+			return !retired && (!boundedBelow || !(k < lowerBound)) && (!boundedAbove || k < upperBound);
+		}
+
+	};
+
+	class Table
+	{
+
+	public:
+
+		// lowerBounds[i] is the smallest key routed to shards[i].
+		// lowerBounds[0] is never read: shard 0 takes everything below lowerBounds[1].
+		std::vector<Key> lowerBounds;
+		std::vector<Shard*> shards;
+
+		size_t shardIndex(const Key & k) const
+		{
+			return std::upper_bound(lowerBounds.begin() + 1, lowerBounds.end(), k) - (lowerBounds.begin() + 1);
+		}
+
+	};
+
+	// Readers count themselves in active[epoch % 2] of their thread's slot.
+	class alignas(64) ReaderSlot
+	{
+
+	public:
+
+		std::atomic<size_t> active[2];
+
+		ReaderSlot()
+		{
+			active[0].store(0);
+			active[1].store(0);
+		}
+
+	};
+
+	static const unsigned READER_SLOTS = 64;
+
+	// While one of these is alive the table it reads cannot be freed.
+	class ReadSection
+	{
+
+	private:
+
+		const ShardedSkipList & owner;
+		std::atomic<size_t>* counter;
+
+	public:
+
+		explicit ReadSection(const ShardedSkipList & owner);
+		~ReadSection();
+
+		ReadSection(const ReadSection &) = delete;
+		ReadSection & operator=(const ReadSection &) = delete;
+
+		const Table & table() const;
+	};
+
+	std::atomic<const Table*> table;
+	mutable ReaderSlot readers[READER_SLOTS];
+	std::atomic<size_t> epoch;
+	// Serializes splits and merges; readers and inserts never take it.
+	std::mutex tableLock;
+	size_t maxShardSize;
+
+public:
+
+	// *maxShardSize* is the size past which an insert splits its shard.
+	// *boundaries* optionally pre-partitions the key space.
+	// Throw a RuntimeException if they are not sorted and free of duplicates.
+	ShardedSkipList(size_t maxShardSize = 4096, const std::vector<Key> & boundaries = {});
+
+	ShardedSkipList(const ShardedSkipList &) = delete;
+	ShardedSkipList & operator=(const ShardedSkipList &) = delete;
+
+	~ShardedSkipList();
+
+	// How many distinct keys are in all shards together?
+	// Each shard is counted under its own lock, so the total is not a
+	// snapshot while other threads insert.
+	size_t size() const;
+
+	bool isEmpty() const;
+
+	// How many shards is the key space currently split into?
+	size_t numShards() const;
+
+	// Return true if this key/value pair is successfully inserted, false if
+	// the key already exists. May split the target shard.
+	bool insert(const Key & k, const Value & v);
+
+	// Return a copy of the value associated with the given key.
+	// Throw a RuntimeException if the key does not exist.
+	Value find(const Key & k) const;
+
+	bool contains(const Key & k) const;
+
+	// Return a vector containing all inserted keys in increasing order.
+	std::vector<Key> allKeysInOrder() const;
+
+	// Return the key/value pairs with keys in [lo, hi], in increasing order.
+	std::vector<std::pair<Key, Value>> range(const Key & lo, const Key & hi) const;
+
+	// Call visit(key, value) for every key in [lo, hi], in increasing order,
+	// walking the shards left to right. Each shard is read-locked while it is
+	// visited, so the result is consistent per shard, not across shards.
+	template<typename Visitor>
+	void forEachInRange(const Key & lo, const Key & hi, Visitor visit) const;
+
+	// Rebalance the shard table online: split shards that are oversized or
+	// take far more than their share of operations, and merge neighbouring
+	// shards that are both small and cold. Access counters are reset.
+	void maintain();
+
+private:
+	// Call op(shard) with the shard owning *k* locked by a *Lock*, routing
+	// again if a split or merge moved the key while the lock was awaited.
+	template<typename Lock, typename Op>
+	auto withShard(const Key & k, Op op) const -> decltype(op(std::declval<Shard &>()));
+
+	// Call visit(shard) on every shard from the one owning *from* (from
+	// shard 0 if *from* is null) rightwards, each read-locked in turn,
+	// until visit returns false.
+	template<typename Visit>
+	void forEachShard(const Key* from, Visit visit) const;
+
+	// The helpers below require tableLock.
+
+	void splitShard(size_t i);
+
+	void mergeShards(size_t i);
+
+	// Free *old*, a table just replaced, and *retiredShard* once no reader
+	// can still be using them.
+	void retire(const Table* old, Shard* retiredShard = nullptr);
+};
+
+template<typename Key, typename Value>
+ShardedSkipList<Key, Value>::ReadSection::ReadSection(const ShardedSkipList & owner):
+	owner(owner),
+	counter(nullptr)
+{
+	static thread_local size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % READER_SLOTS;
+	while(true)
+	{
+		size_t e = owner.epoch.load();
+		counter = &owner.readers[slot].active[e % 2];
+		counter->fetch_add(1);
+		// A writer that flipped the epoch in between may not wait for us.
+		if(owner.epoch.load() == e) break;
+		counter->fetch_sub(1);
+	}
+}
+
+template<typename Key, typename Value>
+ShardedSkipList<Key, Value>::ReadSection::~ReadSection()
+{
+	counter->fetch_sub(1, std::memory_order_release);
+}
+
+template<typename Key, typename Value>
+const typename ShardedSkipList<Key, Value>::Table & ShardedSkipList<Key, Value>::ReadSection::table() const
+{
+	return *owner.table.load(std::memory_order_acquire);
+}
+
+template<typename Key, typename Value>
+ShardedSkipList<Key, Value>::ShardedSkipList(size_t maxShardSize, const std::vector<Key> & boundaries):
+	table(nullptr),
+	epoch(0),
+	maxShardSize(std::max<size_t>(maxShardSize, 2))
+{
+	for(size_t i = 1; i < boundaries.size(); ++i)
+	{
+		if(!(boundaries[i-1] < boundaries[i])) throw RuntimeException("shard boundaries must be sorted and free of duplicates");
+	}
+	Table* initial = new Table();
+	initial->lowerBounds.push_back(Key());
+	initial->lowerBounds.insert(initial->lowerBounds.end(), boundaries.begin(), boundaries.end());
+	for(size_t i = 0; i < initial->lowerBounds.size(); ++i)
+	{
+		Shard* shard = new Shard();
+		shard->boundedBelow = i > 0;
+		if(shard->boundedBelow) shard->lowerBound = initial->lowerBounds[i];
+		shard->boundedAbove = i + 1 < initial->lowerBounds.size();
+		if(shard->boundedAbove) shard->upperBound = initial->lowerBounds[i+1];
+		initial->shards.push_back(shard);
+	}
+	table.store(initial);
+}
+
+template<typename Key, typename Value>
+ShardedSkipList<Key, Value>::~ShardedSkipList()
+{
+	const Table* current = table.load();
+	for(Shard* shard : current->shards)
+	{
+		delete shard;
+	}
+	delete current;
+}
+
+template<typename Key, typename Value>
+size_t ShardedSkipList<Key, Value>::size() const
+{
+	size_t total = 0;
+	forEachShard(nullptr, [&total](Shard & shard)
+	{
+		total += shard.list.size();
+		return true;
+	});
+	return total;
+}
+
+template<typename Key, typename Value>
+bool ShardedSkipList<Key, Value>::isEmpty() const
+{
+	return size() == 0;
+}
+
+template<typename Key, typename Value>
+size_t ShardedSkipList<Key, Value>::numShards() const
+{
+	ReadSection section(*this);
+	return section.table().shards.size();
+}
+
+template<typename Key, typename Value>
+template<typename Lock, typename Op>
+auto ShardedSkipList<Key, Value>::withShard(const Key & k, Op op) const -> decltype(op(std::declval<Shard &>()))
+{
+	ReadSection section(*this);
+	while(true)
+	{
+		const Table & current = section.table();
+		Shard & shard = *current.shards[current.shardIndex(k)];
+		Lock lock(shard.lock);
+		if(shard.owns(k)) return op(shard);
+	}
+}
+
+template<typename Key, typename Value>
+template<typename Visit>
+void ShardedSkipList<Key, Value>::forEachShard(const Key* from, Visit visit) const
+{
+	ReadSection section(*this);
+	Key next = from ? *from : Key();
+	bool bounded = from != nullptr;
+	while(true)
+	{
+		const Table & current = section.table();
+		Shard & shard = *current.shards[bounded ? current.shardIndex(next) : 0];
+		std::shared_lock<std::shared_mutex> lock(shard.lock);
+		// Shard 0 is never merged away, so only a bounded start can go stale.
+		if(bounded && !shard.owns(next)) continue;
+		if(!visit(shard) || !shard.boundedAbove) return;
+		next = shard.upperBound;
+		bounded = true;
+	}
+}
+
+template<typename Key, typename Value>
+bool ShardedSkipList<Key, Value>::insert(const Key & k, const Value & v)
+{
+	bool oversized = false;
+	bool inserted = withShard<std::unique_lock<std::shared_mutex>>(k, [&](Shard & shard)
+	{
+		shard.hits.fetch_add(1, std::memory_order_relaxed);
+		if(!shard.list.insert(k, v)) return false;
+		oversized = shard.list.size() > maxShardSize;
+		return true;
+	});
+	if(oversized)
+	{
+		std::lock_guard<std::mutex> guard(tableLock);
+		// Another writer may have split this range while no lock was held.
+		const Table & current = *table.load();
+		size_t i = current.shardIndex(k);
+		bool stillOversized = false;
+		{
+			std::shared_lock<std::shared_mutex> lock(current.shards[i]->lock);
+			stillOversized = current.shards[i]->list.size() > maxShardSize;
+		}
+		if(stillOversized) splitShard(i);
+	}
+	return inserted;
+}
+
+template<typename Key, typename Value>
+Value ShardedSkipList<Key, Value>::find(const Key & k) const
+{
+	return withShard<std::shared_lock<std::shared_mutex>>(k, [&k](Shard & shard)
+	{
+		shard.hits.fetch_add(1, std::memory_order_relaxed);
+		return Value(shard.list.find(k));
+	});
+}
+
+template<typename Key, typename Value>
+bool ShardedSkipList<Key, Value>::contains(const Key & k) const
+{
+	return withShard<std::shared_lock<std::shared_mutex>>(k, [&k](Shard & shard)
+	{
+		shard.hits.fetch_add(1, std::memory_order_relaxed);
+		return shard.list.contains(k);
+	});
+}
+
+template<typename Key, typename Value>
+std::vector<Key> ShardedSkipList<Key, Value>::allKeysInOrder() const
+{
+	std::vector<Key> r;
+	forEachShard(nullptr, [&r](Shard & shard)
+	{
+		std::vector<Key> keys = shard.list.allKeysInOrder();
+		r.insert(r.end(), keys.begin(), keys.end());
+		return true;
+	});
+	return r;
+}
+
+template<typename Key, typename Value>
+std::vector<std::pair<Key, Value>> ShardedSkipList<Key, Value>::range(const Key & lo, const Key & hi) const
+{
+	std::vector<std::pair<Key, Value>> r;
+	forEachInRange(lo, hi, [&r](const Key & k, const Value & v)
+	{
+		r.emplace_back(k, v);
+	});
+	return r;
+}
+
+template<typename Key, typename Value>
+template<typename Visitor>
+void ShardedSkipList<Key, Value>::forEachInRange(const Key & lo, const Key & hi, Visitor visit) const
+{
+	if(hi < lo) return;
+	forEachShard(&lo, [&](Shard & shard)
+	{
+		shard.hits.fetch_add(1, std::memory_order_relaxed);
+		shard.list.forEachInRange(lo, hi, visit);
+		return shard.boundedAbove && !(hi < shard.upperBound);
+	});
+}
+
+template<typename Key, typename Value>
+void ShardedSkipList<Key, Value>::maintain()
+{
+	std::lock_guard<std::mutex> guard(tableLock);
+	// Only this thread replaces the table while tableLock is held, so it
+	// may read the current one without a ReadSection.
+	const Table* current = table.load();
+	std::vector<size_t> sizes;
+	size_t totalHits = 0;
+	for(Shard* shard : current->shards)
+	{
+		std::shared_lock<std::shared_mutex> lock(shard->lock);
+		sizes.push_back(shard->list.size());
+		totalHits += shard->hits.load(std::memory_order_relaxed);
+	}
+	// A shard is hot once it takes four times its fair share of operations.
+	// Merges use the same bar so a merged shard is not split straight back.
+	size_t hotHits = 4 * ((totalHits + sizes.size() - 1) / sizes.size());
+	for(size_t i = 0; i < sizes.size(); ++i)
+	{
+		size_t hits = table.load()->shards[i]->hits.load(std::memory_order_relaxed);
+		bool hot = hits > hotHits && sizes[i] >= maxShardSize / 8;
+		if(sizes[i] >= 2 && (sizes[i] > maxShardSize || hot))
+		{
+			splitShard(i);
+			sizes[i] = sizes[i] / 2;
+			sizes.insert(sizes.begin() + i + 1, sizes[i]);
+			++i;
+		}
+	}
+	for(size_t i = 0; i + 1 < sizes.size();)
+	{
+		current = table.load();
+		size_t combinedSize = sizes[i] + sizes[i+1];
+		size_t combinedHits = current->shards[i]->hits.load(std::memory_order_relaxed) + current->shards[i+1]->hits.load(std::memory_order_relaxed);
+		if(combinedSize <= maxShardSize / 2 && combinedHits <= hotHits)
+		{
+			mergeShards(i);
+			sizes[i] = combinedSize;
+			sizes.erase(sizes.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+	for(Shard* shard : table.load()->shards)
+	{
+		shard->hits.store(0, std::memory_order_relaxed);
+	}
+}
+
+template<typename Key, typename Value>
+void ShardedSkipList<Key, Value>::splitShard(size_t i)
+{
+	const Table* old = table.load();
+	Shard* lower = old->shards[i];
+	Table* next = new Table(*old);
+	{
+		std::unique_lock<std::shared_mutex> lock(lower->lock);
+		SkipList<Key, Value> & list = lower->list;
+		if(list.size() < 2)
+		{
+			delete next;
+			return;
+		}
+		// Walk to the median rather than copying every key.
+		typename SkipList<Key, Value>::Cursor median = list.cursor();
+		for(size_t step = list.size() / 2; step > 0; --step)
+		{
+			median.next();
+		}
+		Key pivot = median.key();
+		// *upper* is unreachable until the new table is published.
+		Shard* upper = new Shard();
+		list.splitAt(pivot, upper->list);
+		upper->boundedBelow = true;
+		upper->lowerBound = pivot;
+		upper->boundedAbove = lower->boundedAbove;
+		upper->upperBound = lower->upperBound;
+		lower->boundedAbove = true;
+		lower->upperBound = pivot;
+		size_t hits = lower->hits.load(std::memory_order_relaxed) / 2;
+		lower->hits.store(hits, std::memory_order_relaxed);
+		upper->hits.store(hits, std::memory_order_relaxed);
+		next->lowerBounds.insert(next->lowerBounds.begin() + i + 1, pivot);
+		next->shards.insert(next->shards.begin() + i + 1, upper);
+		// Published before the shard unlocks, so a reader that finds the
+		// key gone from *lower* routes with the new table.
+		table.store(next);
+	}
+	retire(old);
+}
+
+template<typename Key, typename Value>
+void ShardedSkipList<Key, Value>::mergeShards(size_t i)
+{
+	const Table* old = table.load();
+	Shard* lower = old->shards[i];
+	Shard* upper = old->shards[i+1];
+	Table* next = new Table(*old);
+	{
+		std::unique_lock<std::shared_mutex> lowerLock(lower->lock);
+		std::unique_lock<std::shared_mutex> upperLock(upper->lock);
+		lower->list.append(upper->list);
+		lower->hits.fetch_add(upper->hits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		lower->boundedAbove = upper->boundedAbove;
+		lower->upperBound = upper->upperBound;
+		upper->retired = true;
+		next->lowerBounds.erase(next->lowerBounds.begin() + i + 1);
+		next->shards.erase(next->shards.begin() + i + 1);
+		table.store(next);
+	}
+	retire(old, upper);
+}
+
+template<typename Key, typename Value>
+void ShardedSkipList<Key, Value>::retire(const Table* old, Shard* retiredShard)
+{
+	// Readers that enter from now on see the new table. Wait out the ones
+	// that entered under the previous epoch, then nothing can reach *old*.
+	size_t e = epoch.fetch_add(1);
+	for(ReaderSlot & slot : readers)
+	{
+		while(slot.active[e % 2].load() != 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+	delete old;
+	delete retiredShard;
+}
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef ___SHARED_SKIP_LIST_HPP
+#define ___SHARED_SKIP_LIST_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SkipList.hpp"
+#include "runtimeexcept.hpp"
+
+// A skip list that lives entirely inside a POSIX shared-memory segment so
+// several processes can map one copy of it.
+//
+// The layout mirrors SkipList: one node per key per lane, linked by
+// next/prev/down/up. Links are byte offsets from the start of the segment
+// (0 means null) so each process can map the segment at a different address.
+// Nodes are carved from the segment with a bump allocator and never freed.
+//
+// One process creates the segment and is the only writer. Any number of
+// processes open it read-only. Readers never lock: the writer bumps a
+// version counter to an odd value before changing links and back to even
+// afterwards (a seqlock). A reader retries any lookup or scan during which
+// the version was odd or changed.
+//
+// If the writer dies in the middle of an insert, the version stays odd for
+// good. Readers give up after the writer timeout and throw; the segment
+// cannot be repaired in place, so remove it and have a new writer recreate
+// and refill it.
+//
+// Keys and values are copied into the segment byte for byte, so both must
+// be trivially copyable (no std::string).
+template<typename Key, typename Value> class SharedSkipList;
+
+template<typename Key, typename Value>
+class SharedSkipNode
+{
+	friend class SharedSkipList<Key, Value>;
+
+private:
+
+	Key key;
+	Value val;
+	std::atomic<std::uint64_t> next;
+	std::atomic<std::uint64_t> prev;
+	std::atomic<std::uint64_t> down;
+	std::atomic<std::uint64_t> up;
+
+public:
+
+	SharedSkipNode(const Key & key = Key(), const Value & val = Value()):
+	key(key),
+	val(val),
+	next(0),
+	prev(0),
+	down(0),
+	up(0)
+	{
+
+	}
+
+};
+
+class SharedSegmentHeader
+{
+
+public:
+
+	std::uint64_t magic;
+	std::uint64_t capacity;
+	std::uint32_t keySize;
+	std::uint32_t valueSize;
+	std::atomic<std::uint64_t> version;
+	std::atomic<std::uint64_t> used;
+	std::atomic<std::uint64_t> nodeCount;
+	std::atomic<std::uint32_t> layerCount;
+	std::uint32_t layerCapacity;
+	std::atomic<std::uint64_t> topHead;
+	std::atomic<std::uint64_t> topRear;
+	std::atomic<std::uint64_t> btmHead;
+	std::atomic<std::uint64_t> btmRear;
+	// laneCounts[i] is how many keys reach lane S_i. Only the writer reads
+	// it. layerCapacity stays below 3 * 64 + 1, so no tower goes past it.
+	static const unsigned MAX_LANES = 3 * 64 + 1;
+	std::uint64_t laneCounts[MAX_LANES];
+
+};
+
+template<typename Key, typename Value>
+class SharedSkipList
+{
+
+	static_assert(std::is_trivially_copyable<Key>::value, "shared keys must be trivially copyable");
+	static_assert(std::is_trivially_copyable<Value>::value, "shared values must be trivially copyable");
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "offsets must be lock-free to be shared across processes");
+
+private:
+
+	typedef SharedSkipNode<Key, Value> Node;
+
+	static const std::uint64_t MAGIC = 0x534b49504c495354ull; // "SKIPLIST"
+
+	int fd;
+	unsigned char* base;
+	size_t mappedSize;
+	bool writable;
+	SharedSegmentHeader* header;
+	std::chrono::milliseconds writerTimeout;
+
+public:
+
+	// Create the segment *name* (e.g. "/orders-index") with room for
+	// *capacityBytes* bytes and open it as the writer.
+	// Throw a RuntimeException if the segment already exists or cannot be mapped.
+	SharedSkipList(const std::string & name, size_t capacityBytes);
+
+	// Open an existing segment *name* read-only.
+	// Throw a RuntimeException if it does not exist or holds a different Key/Value type.
+	explicit SharedSkipList(const std::string & name);
+
+	SharedSkipList(const SharedSkipList &) = delete;
+	SharedSkipList & operator=(const SharedSkipList &) = delete;
+
+	// Unmaps the segment. The segment itself survives until removeSegment.
+	~SharedSkipList();
+
+	// Remove the segment name from the system. Processes that have it mapped
+	// keep working on their mapping.
+	static void removeSegment(const std::string & name);
+
+	size_t size() const noexcept;
+
+	bool isEmpty() const noexcept;
+
+	unsigned numLayers() const noexcept;
+
+	// How many bytes of the segment have been handed out to nodes so far?
+	size_t bytesUsed() const noexcept;
+
+	// How long a read waits for an update in progress before concluding
+	// that the writer died mid-update. One second by default.
+	void setWriterTimeout(std::chrono::milliseconds timeout);
+
+	// Return a copy of the value associated with the given key.
+	// Throw a RuntimeException if the key does not exist, or if a write
+	// has been in progress for longer than the writer timeout.
+	Value find(const Key & k) const;
+
+	bool contains(const Key & k) const;
+
+	// Return a vector containing all inserted keys in increasing order.
+	std::vector<Key> allKeysInOrder() const;
+
+	// Call visit(key, value) for every key in [lo, hi], in increasing order.
+	// The pairs are copied out under one consistent version before any is visited.
+	template<typename Visitor>
+	void forEachInRange(const Key & lo, const Key & hi, Visitor visit) const;
+
+	// Return true if this key/value pair is successfully inserted, false if
+	// the key already exists. Tower heights follow SkipList::insert.
+	// Throw a RuntimeException if this mapping is read-only or the segment is full.
+	bool insert(const Key & k, const Value & v);
+
+private:
+	void map(const std::string & name, size_t size, int prot);
+
+	Node* at(std::uint64_t offset) const;
+
+	std::uint64_t allocate(const Key & k, const Value & v);
+
+	void addLayer();
+
+	// Follow the lanes down to the first bottom node whose key is not less than *k*.
+	// Return false if the links read were torn by a concurrent write.
+	bool lowerBound(const Key & k, Node* & result, std::vector<Node*>* preds) const;
+
+	// Retry *read* until it completes without overlapping a write.
+	// Throw a RuntimeException once the writer timeout passes without one.
+	template<typename Read>
+	void readConsistent(Read read) const;
+};
+
+template<typename Key, typename Value>
+SharedSkipList<Key, Value>::SharedSkipList(const std::string & name, size_t capacityBytes):
+	fd(-1),
+	base(nullptr),
+	mappedSize(0),
+	writable(true),
+	header(nullptr),
+	writerTimeout(1000)
+{
+	if(capacityBytes < sizeof(SharedSegmentHeader) + 8 * sizeof(Node)) throw RuntimeException("shared segment is too small");
+	fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if(fd < 0) throw RuntimeException("cannot create shared segment " + name);
+	if(ftruncate(fd, capacityBytes) != 0)
+	{
+		close(fd);
+		shm_unlink(name.c_str());
+		throw RuntimeException("cannot size shared segment " + name);
+	}
+	map(name, capacityBytes, PROT_READ | PROT_WRITE);
+	header = new (base) SharedSegmentHeader();
+	header->capacity = capacityBytes;
+	header->keySize = sizeof(Key);
+	header->valueSize = sizeof(Value);
+	header->version.store(0);
+	header->used.store((sizeof(SharedSegmentHeader) + alignof(Node) - 1) / alignof(Node) * alignof(Node));
+	header->nodeCount.store(0);
+	header->layerCount.store(2);
+	header->layerCapacity = 13;
+	Node* topHead = at(header->topHead = allocate(Key(), Value()));
+	Node* topRear = at(header->topRear = allocate(Key(), Value()));
+	Node* btmHead = at(header->btmHead = allocate(Key(), Value()));
+	Node* btmRear = at(header->btmRear = allocate(Key(), Value()));
+	topHead->next = header->topRear.load();
+	topRear->prev = header->topHead.load();
+	topHead->down = header->btmHead.load();
+	topRear->down = header->btmRear.load();
+	btmHead->next = header->btmRear.load();
+	btmRear->prev = header->btmHead.load();
+	btmHead->up = header->topHead.load();
+	btmRear->up = header->topRear.load();
+	// Readers check the magic number last, so it goes in once the rest is ready.
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = MAGIC;
+}
+
+template<typename Key, typename Value>
+SharedSkipList<Key, Value>::SharedSkipList(const std::string & name):
+	fd(-1),
+	base(nullptr),
+	mappedSize(0),
+	writable(false),
+	header(nullptr),
+	writerTimeout(1000)
+{
+	fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if(fd < 0) throw RuntimeException("cannot open shared segment " + name);
+	struct stat st;
+	if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SharedSegmentHeader))
+	{
+		close(fd);
+		throw RuntimeException("shared segment " + name + " is not initialized");
+	}
+	map(name, st.st_size, PROT_READ);
+	header = reinterpret_cast<SharedSegmentHeader*>(base);
+	if(header->magic != MAGIC || header->keySize != sizeof(Key) || header->valueSize != sizeof(Value) || header->capacity != mappedSize)
+	{
+		munmap(base, mappedSize);
+		close(fd);
+		throw RuntimeException("shared segment " + name + " does not hold this kind of Skip List");
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+template<typename Key, typename Value>
+SharedSkipList<Key, Value>::~SharedSkipList()
+{
+	munmap(base, mappedSize);
+	close(fd);
+}
+
+template<typename Key, typename Value>
+void SharedSkipList<Key, Value>::removeSegment(const std::string & name)
+{
+	shm_unlink(name.c_str());
+}
+
+template<typename Key, typename Value>
+void SharedSkipList<Key, Value>::map(const std::string & name, size_t size, int prot)
+{
+	void* address = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+	if(address == MAP_FAILED)
+	{
+		close(fd);
+		if(prot & PROT_WRITE) shm_unlink(name.c_str());
+		throw RuntimeException("cannot map shared segment " + name);
+	}
+	base = static_cast<unsigned char*>(address);
+	mappedSize = size;
+}
+
+template<typename Key, typename Value>
+size_t SharedSkipList<Key, Value>::size() const noexcept
+{
+	return header->nodeCount.load(std::memory_order_acquire);
+}
+
+template<typename Key, typename Value>
+bool SharedSkipList<Key, Value>::isEmpty() const noexcept
+{
+	return size() == 0;
+}
+
+template<typename Key, typename Value>
+unsigned SharedSkipList<Key, Value>::numLayers() const noexcept
+{
+	return header->layerCount.load(std::memory_order_acquire);
+}
+
+template<typename Key, typename Value>
+size_t SharedSkipList<Key, Value>::bytesUsed() const noexcept
+{
+	return header->used.load(std::memory_order_acquire);
+}
+
+template<typename Key, typename Value>
+void SharedSkipList<Key, Value>::setWriterTimeout(std::chrono::milliseconds timeout)
+{
+	writerTimeout = timeout;
+}
+
+// A reader may follow a link the writer is halfway through changing, so
+// every offset is range-checked before it is turned into a pointer.
+template<typename Key, typename Value>
+SharedSkipNode<Key, Value>* SharedSkipList<Key, Value>::at(std::uint64_t offset) const
+{
+	if(offset < sizeof(SharedSegmentHeader) || offset > mappedSize - sizeof(Node) || offset % alignof(Node) != 0) return nullptr;
+	return reinterpret_cast<Node*>(base + offset);
+}
+
+template<typename Key, typename Value>
+std::uint64_t SharedSkipList<Key, Value>::allocate(const Key & k, const Value & v)
+{
+	std::uint64_t offset = header->used.load(std::memory_order_relaxed);
+	std::uint64_t end = offset + (sizeof(Node) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+	if(end > mappedSize) throw RuntimeException("shared segment is full");
+	new (base + offset) Node(k, v);
+	header->used.store(end, std::memory_order_release);
+	return offset;
+}
+
+template<typename Key, typename Value>
+template<typename Read>
+void SharedSkipList<Key, Value>::readConsistent(Read read) const
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + writerTimeout;
+	while(true)
+	{
+		std::uint64_t before = header->version.load(std::memory_order_acquire);
+		if(before % 2 == 0 && read())
+		{
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(header->version.load(std::memory_order_relaxed) == before) return;
+		}
+		if(std::chrono::steady_clock::now() > deadline)
+		{
+			throw RuntimeException("shared segment is stuck mid-update; remove and recreate it");
+		}
+		std::this_thread::yield();
+	}
+}
+
+template<typename Key, typename Value>
+bool SharedSkipList<Key, Value>::lowerBound(const Key & k, Node* & result, std::vector<Node*>* preds) const
+{
+	unsigned layers = header->layerCount.load(std::memory_order_relaxed);
+	// Keys only ever increase along a lane, but a torn read can still lead
+	// anywhere, so the walk is capped at the number of nodes that can exist.
+	size_t steps = mappedSize / sizeof(Node);
+	Node* topHead = at(header->topHead.load(std::memory_order_relaxed));
+	if(!topHead || layers < 2) return false;
+	Node* current = at(topHead->down.load(std::memory_order_relaxed));
+	if(preds) preds->resize(layers - 1);
+	for(unsigned level = layers - 1; level-- > 0;)
+	{
+		if(!current) return false;
+		while(true)
+		{
+			Node* next = at(current->next.load(std::memory_order_relaxed));
+			if(!next || steps-- == 0) return false;
+			if(next->next.load(std::memory_order_relaxed) == 0 || !(next->key < k)) break;
+			current = next;
+		}
+		if(preds) (*preds)[level] = current;
+		if(level > 0) current = at(current->down.load(std::memory_order_relaxed));
+	}
+	result = at(current->next.load(std::memory_order_relaxed));
+	return result != nullptr;
+}
+
+template<typename Key, typename Value>
+Value SharedSkipList<Key, Value>::find(const Key & k) const
+{
+	bool found = false;
+	Value result = Value();
+	readConsistent([&]()
+	{
+		Node* current = nullptr;
+		if(!lowerBound(k, current, nullptr)) return false;
+		found = current->next.load(std::memory_order_relaxed) != 0 && current->key == k;
+		if(found) result = current->val;
+		return true;
+	});
+	if(!found) throw RuntimeException("key is not in the Skip List");
+	return result;
+}
+
+template<typename Key, typename Value>
+bool SharedSkipList<Key, Value>::contains(const Key & k) const
+{
+	bool found = false;
+	readConsistent([&]()
+	{
+		Node* current = nullptr;
+		if(!lowerBound(k, current, nullptr)) return false;
+		found = current->next.load(std::memory_order_relaxed) != 0 && current->key == k;
+		return true;
+	});
+	return found;
+}
+
+template<typename Key, typename Value>
+std::vector<Key> SharedSkipList<Key, Value>::allKeysInOrder() const
+{
+	std::vector<Key> r;
+	readConsistent([&]()
+	{
+		r.clear();
+		size_t steps = mappedSize / sizeof(Node);
+		Node* current = at(header->btmHead.load(std::memory_order_relaxed));
+		if(!current) return false;
+		current = at(current->next.load(std::memory_order_relaxed));
+		while(current && current->next.load(std::memory_order_relaxed) != 0)
+		{
+			if(steps-- == 0) return false;
+			r.push_back(current->key);
+			current = at(current->next.load(std::memory_order_relaxed));
+		}
+		return current != nullptr;
+	});
+	return r;
+}
+
+template<typename Key, typename Value>
+template<typename Visitor>
+void SharedSkipList<Key, Value>::forEachInRange(const Key & lo, const Key & hi, Visitor visit) const
+{
+	std::vector<std::pair<Key, Value>> r;
+	readConsistent([&]()
+	{
+		r.clear();
+		size_t steps = mappedSize / sizeof(Node);
+		Node* current = nullptr;
+		if(!lowerBound(lo, current, nullptr)) return false;
+		while(current && current->next.load(std::memory_order_relaxed) != 0 && !(hi < current->key))
+		{
+			if(steps-- == 0) return false;
+			r.emplace_back(current->key, current->val);
+			current = at(current->next.load(std::memory_order_relaxed));
+		}
+		return current != nullptr;
+	});
+	for(const std::pair<Key, Value> & entry : r)
+	{
+		visit(entry.first, entry.second);
+	}
+}
+
+template<typename Key, typename Value>
+bool SharedSkipList<Key, Value>::insert(const Key & k, const Value & v)
+{
+	if(!writable) throw RuntimeException("shared segment is mapped read-only");
+	// The writer is the only thread that changes links, so it never sees a torn read.
+	std::vector<Node*> preds;
+	Node* successor = nullptr;
+	lowerBound(k, successor, &preds);
+	if(successor->next.load(std::memory_order_relaxed) != 0 && successor->key == k) return false;
+	std::uint64_t nodeCount = header->nodeCount.load(std::memory_order_relaxed) + 1;
+	if(nodeCount > 16) header->layerCapacity = 3 * std::ceil(std::log2(nodeCount)) + 1;
+	unsigned flipCoinCount = towerFlips(k, header->layerCapacity, [this](unsigned lane) -> std::uint64_t
+	{
+		return lane < SharedSegmentHeader::MAX_LANES ? header->laneCounts[lane] : 0;
+	});
+	unsigned layers = header->layerCount.load(std::memory_order_relaxed);
+	unsigned newLayers = flipCoinCount >= layers - 1 ? flipCoinCount - (layers - 1) + 1 : 0;
+	size_t needed = (flipCoinCount + 1 + 2 * newLayers) * ((sizeof(Node) + alignof(Node) - 1) / alignof(Node) * alignof(Node));
+	if(header->used.load(std::memory_order_relaxed) + needed > mappedSize) throw RuntimeException("shared segment is full");
+
+	// Nodes are filled in before the version goes odd; readers cannot reach them yet.
+	std::vector<std::uint64_t> tower(flipCoinCount + 1);
+	for(unsigned i = 0; i <= flipCoinCount; ++i)
+	{
+		tower[i] = i == 0 ? allocate(k, v) : allocate(k, Value());
+	}
+	std::uint64_t version = header->version.load(std::memory_order_relaxed);
+	header->version.store(version + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for(unsigned i = 0; i < newLayers; ++i)
+	{
+		addLayer();
+	}
+	Node* currentHead = at(header->btmHead.load(std::memory_order_relaxed));
+	for(unsigned i = 0; i <= flipCoinCount; ++i)
+	{
+		Node* previous = i < preds.size() ? preds[i] : currentHead;
+		Node* newNode = at(tower[i]);
+		std::uint64_t nextOffset = previous->next.load(std::memory_order_relaxed);
+		newNode->next.store(nextOffset, std::memory_order_relaxed);
+		newNode->prev.store(static_cast<std::uint64_t>(reinterpret_cast<unsigned char*>(previous) - base), std::memory_order_relaxed);
+		newNode->down.store(i == 0 ? 0 : tower[i - 1], std::memory_order_relaxed);
+		if(i > 0) at(tower[i - 1])->up.store(tower[i], std::memory_order_relaxed);
+		at(nextOffset)->prev.store(tower[i], std::memory_order_relaxed);
+		previous->next.store(tower[i], std::memory_order_relaxed);
+		currentHead = at(currentHead->up.load(std::memory_order_relaxed));
+		++header->laneCounts[i];
+	}
+	header->nodeCount.store(nodeCount, std::memory_order_relaxed);
+	header->version.store(version + 2, std::memory_order_release);
+	return true;
+}
+
+// Must be called between the two version bumps of a write.
+template<typename Key, typename Value>
+void SharedSkipList<Key, Value>::addLayer()
+{
+	std::uint64_t newLayerHead = allocate(Key(), Value());
+	std::uint64_t newLayerRear = allocate(Key(), Value());
+	Node* topHead = at(header->topHead.load(std::memory_order_relaxed));
+	Node* topRear = at(header->topRear.load(std::memory_order_relaxed));
+	Node* head = at(newLayerHead);
+	Node* rear = at(newLayerRear);
+	head->next.store(newLayerRear, std::memory_order_relaxed);
+	rear->prev.store(newLayerHead, std::memory_order_relaxed);
+	at(topHead->down.load(std::memory_order_relaxed))->up.store(newLayerHead, std::memory_order_relaxed);
+	head->down.store(topHead->down.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	topHead->down.store(newLayerHead, std::memory_order_relaxed);
+	head->up.store(header->topHead.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	at(topRear->down.load(std::memory_order_relaxed))->up.store(newLayerRear, std::memory_order_relaxed);
+	rear->down.store(topRear->down.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	topRear->down.store(newLayerRear, std::memory_order_relaxed);
+	rear->up.store(header->topRear.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	header->layerCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+#endif
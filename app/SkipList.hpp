@@ -1,11 +1,16 @@
 #ifndef ___SKIP_LIST_HPP
 #define ___SKIP_LIST_HPP
 
+#include <algorithm>
 #include <cmath> // for log2
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <string>
 #include <vector>
 #include <memory>
 #include <limits>
+#include <utility>
 #include <iostream>
 
 #include "runtimeexcept.hpp"
@@ -38,14 +43,98 @@ static bool flipCoin(std::string s, unsigned i)
 	return ( c & (1 << i) ) != 0;
 }
 
-template<typename Key, typename Value> class SkipList;
+// How many heads does *k* flip in a row, stopping at *layerCapacity* - 2?
+template<typename Key>
+static unsigned keyFlips(const Key & k, unsigned layerCapacity)
+{
+	unsigned flipCoinCount = 0;
+	while(flipCoin(k, flipCoinCount) && flipCoinCount < layerCapacity-2)
+	{
+		++flipCoinCount;
+	}
+	return flipCoinCount;
+}
+
+// Lists holding fewer keys than this give every new tower the height its
+// coin flips call for.
+static const unsigned CAPPED_TOWER_MIN_KEYS = 16;
+
+// How many lanes above S_0 should a new tower for *k* reach?
+// *laneCount(i)* is how many keys reach lane S_i, zero past the top.
+//
+// The flips repeat every eight lanes, so every key whose bytes XOR to
+// 0xFF would climb to the cap and the top lanes would all hold the same
+// n / 256 towers, making each search scan them. Once the list holds
+// CAPPED_TOWER_MIN_KEYS keys, a tower therefore also stops below the
+// first lane that already holds more than half the keys of the one
+// beneath it. Towers that are still too short or too tall are what
+// SkipList::rebalance() is for.
+template<typename Key, typename LaneCount>
+static unsigned towerFlips(const Key & k, unsigned layerCapacity, LaneCount laneCount)
+{
+	unsigned flipCoinCount = keyFlips(k, layerCapacity);
+	if(laneCount(0) < CAPPED_TOWER_MIN_KEYS) return flipCoinCount;
+	for(unsigned lane = 0; lane < flipCoinCount; ++lane)
+	{
+		if(2 * laneCount(lane + 1) > laneCount(lane)) return lane;
+	}
+	return flipCoinCount;
+}
+
+// An Aggregate describes a monoid over values that a SkipList keeps folded
+// over the span of bottom nodes each upper-lane link skips:
+//
+//   typedef ... Type;
+//   Type identity() const;
+//   Type lift(const Value & v) const;
+//   Type combine(const Type & a, const Type & b) const;   // associative
+//
+// NoAggregate, the default, turns the bookkeeping off entirely.
+class NoAggregate
+{
+	
+public:
+	
+	static constexpr bool enabled = false;
+	typedef void Type;
+	
+};
+
+// Per-node storage for the folded aggregate; empty when aggregates are off.
+template<typename Aggregate, bool = Aggregate::enabled>
+class AggregateSlot
+{
+	
+};
+
+template<typename Aggregate>
+class AggregateSlot<Aggregate, true>
+{
+	
+protected:
+	
+	typename Aggregate::Type agg;
+	
+public:
+	
+	AggregateSlot():
+	agg(Aggregate().identity())
+	{
+		
+	}
+	
+};
+
+template<typename Key, typename Value, typename Aggregate = NoAggregate> class SkipList;
+template<typename Key, typename Value, typename Aggregate> class SkipListHashIndex;
 template<typename Key, typename Value> class SkipListIterator;
 template<typename Value> class SkipListIterator<std::string, Value>;
 
-template<typename Key, typename Value>
-class SkipNode
+template<typename Key, typename Value, typename Aggregate = NoAggregate>
+class SkipNode : public AggregateSlot<Aggregate>
 {
-	friend class SkipList<Key, Value>;
+	template<typename, typename, typename> friend class SkipList;
+	friend class SkipListHashIndex<Key, Value, Aggregate>;
 	friend class SkipListIterator<Key, Value>;
 	friend class SkipListIterator<std::string, Value>;
 	
@@ -53,10 +142,10 @@ private:
 	
 	Key key;
 	Value val;
-	SkipNode<Key, Value>* next;
-	SkipNode<Key, Value>* prev;
-	SkipNode<Key, Value>* down;
-	SkipNode<Key, Value>* up;
+	SkipNode<Key, Value, Aggregate>* next;
+	SkipNode<Key, Value, Aggregate>* prev;
+	SkipNode<Key, Value, Aggregate>* down;
+	SkipNode<Key, Value, Aggregate>* up;
 	
 public:
 	
@@ -77,6 +166,106 @@ public:
 	
 };
 
+// An open-addressing (linear probing) table from keys to their bottom-lane
+// nodes, so exact-key lookups can skip the descent through the towers.
+// Capacity is a power of two kept at least twice the entry count; erasing
+// shifts later entries of the probe run back instead of leaving tombstones.
+template<typename Key, typename Value, typename Aggregate>
+class SkipListHashIndex
+{
+	
+private:
+	
+	std::vector<SkipNode<Key, Value, Aggregate>*> slots;
+	size_t count;
+	unsigned bits;
+	
+	size_t home(const Key & k) const
+	{
+		// Fibonacci hashing spreads identity hashes such as std::hash<unsigned>.
+		return static_cast<size_t>((static_cast<std::uint64_t>(std::hash<Key>()(k)) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+	}
+	
+	void place(SkipNode<Key, Value, Aggregate>* node)
+	{
+		size_t mask = slots.size() - 1;
+		size_t i = home(node->key);
+		while(slots[i])
+		{
+			i = (i + 1) & mask;
+		}
+		slots[i] = node;
+	}
+	
+	void grow()
+	{
+		std::vector<SkipNode<Key, Value, Aggregate>*> old(slots.size() * 2, nullptr);
+		old.swap(slots);
+		++bits;
+		for(SkipNode<Key, Value, Aggregate>* node : old)
+		{
+			if(node) place(node);
+		}
+	}
+	
+public:
+	
+	SkipListHashIndex():
+	slots(16, nullptr),
+	count(0),
+	bits(4)
+	{
+		
+	}
+	
+	SkipNode<Key, Value, Aggregate>* find(const Key & k) const
+	{
+		size_t mask = slots.size() - 1;
+		for(size_t i = home(k); slots[i]; i = (i + 1) & mask)
+		{
+			if(slots[i]->key == k) return slots[i];
+		}
+		return nullptr;
+	}
+	
+	// *node*'s key must not be in the index yet.
+	void insert(SkipNode<Key, Value, Aggregate>* node)
+	{
+		if(2 * (count + 1) > slots.size()) grow();
+		place(node);
+		++count;
+	}
+	
+	void erase(SkipNode<Key, Value, Aggregate>* node)
+	{
+		size_t mask = slots.size() - 1;
+		size_t i = home(node->key);
+		while(slots[i] != node)
+		{
+			if(!slots[i]) return;
+			i = (i + 1) & mask;
+		}
+		for(size_t j = (i + 1) & mask; slots[j]; j = (j + 1) & mask)
+		{
+			// slots[j] may fill the hole at i unless its home lies in (i, j].
+			size_t h = home(slots[j]->key);
+			if(((j - h) & mask) >= ((j - i) & mask))
+			{
+				slots[i] = slots[j];
+				i = j;
+			}
+		}
+		slots[i] = nullptr;
+		--count;
+	}
+	
+	size_t memoryUsage() const
+	{
+		return sizeof(*this) + slots.capacity() * sizeof(SkipNode<Key, Value, Aggregate>*);
+	}
+	
+};
+
 template<typename Key>
 class MinLimits
 {
@@ -129,15 +318,76 @@ public:
 	
 };
 
+template<typename Value>
+class SumAggregate
+{
+	
+public:
+	
+	static constexpr bool enabled = true;
+	typedef Value Type;
+	
+	Type identity() const { return Value(); }
+	Type lift(const Value & v) const { return v; }
+	Type combine(const Type & a, const Type & b) const { return a + b; }
+	
+};
+
+template<typename Value>
+class MinAggregate
+{
+	
+public:
+	
+	static constexpr bool enabled = true;
+	typedef Value Type;
+	
+	Type identity() const { return std::numeric_limits<Value>::max(); }
+	Type lift(const Value & v) const { return v; }
+	Type combine(const Type & a, const Type & b) const { return b < a ? b : a; }
+	
+};
+
+template<typename Value>
+class MaxAggregate
+{
+	
+public:
+	
+	static constexpr bool enabled = true;
+	typedef Value Type;
+	
+	Type identity() const { return std::numeric_limits<Value>::lowest(); }
+	Type lift(const Value & v) const { return v; }
+	Type combine(const Type & a, const Type & b) const { return a < b ? b : a; }
+	
+};
+
+template<typename Value>
+class CountAggregate
+{
+	
+public:
+	
+	static constexpr bool enabled = true;
+	typedef size_t Type;
+	
+	Type identity() const { return 0; }
+	Type lift(const Value &) const { return 1; }
+	Type combine(const Type & a, const Type & b) const { return a + b; }
+	
+};
+
 template<typename Key, typename Value>
 class SkipListIterator
 {
 	
-	friend class SkipList<Key, Value>;
+	template<typename, typename, typename> friend class SkipList;
 	
 private:
 	
-	SkipNode<Key, Value>* findNode(SkipNode<Key, Value>* current, const Key& target,  SkipNode<Key, Value>* currentHead) const
+	template<typename Node>
+	Node* findNode(Node* current, const Key& target, Node* currentHead) const
 	{
 		current = current->next;
 		currentHead = currentHead->down;
@@ -183,11 +433,12 @@ template<typename Value>
 class SkipListIterator<std::string, Value>
 {
 	
-	friend class SkipList<std::string, Value>;
+	template<typename, typename, typename> friend class SkipList;
 	
 private:
 	
-	SkipNode<std::string, Value>* findNode(SkipNode<std::string, Value>* current, const std::string& target, SkipNode<std::string, Value>* currentHead) const
+	template<typename Node>
+	Node* findNode(Node* current, const std::string& target, Node* currentHead) const
 	{
 		currentHead = currentHead->down;
 		while(current != nullptr)
@@ -214,7 +465,7 @@ private:
 		return current;
 	}
 	
-	bool isFirstParameterGreater(const std::string & k1, const std::string & k2)
+	bool isFirstParameterGreater(const std::string & k1, const std::string & k2) const
 	{
 		return k1 > k2;
 	}
@@ -222,23 +473,121 @@ private:
 };
 
 
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Aggregate>
 class SkipList
 {
 	
 private:
 	// private variables go here.
-	SkipNode<Key, Value>* topHead;
-	SkipNode<Key, Value>* topRear;
-	SkipNode<Key, Value>* btmHead;
-	SkipNode<Key, Value>* btmRear;
+	// Everything the list only needs once it has towers. It shares its
+	// storage with inlineEntries, so only one of the two is alive at a time.
+	class Towers
+	{
+
+	public:
+
+		SkipNode<Key, Value, Aggregate>* topHead;
+		SkipNode<Key, Value, Aggregate>* topRear;
+		SkipNode<Key, Value, Aggregate>* btmHead;
+		SkipNode<Key, Value, Aggregate>* btmRear;
+		std::vector<SkipNode<Key, Value, Aggregate>*> predecessors;
+		// laneCounts[i] is how many keys reach lane S_i.
+		std::vector<size_t> laneCounts;
+		// State of the re-leveling pass; rebalanceCursor is null when none is running.
+		SkipNode<Key, Value, Aggregate>* rebalanceCursor;
+		size_t rebalanceRank;
+		std::vector<SkipNode<Key, Value, Aggregate>*> rebalanceLast;
+
+		Towers():
+		topHead(nullptr),
+		topRear(nullptr),
+		btmHead(nullptr),
+		btmRear(nullptr),
+		rebalanceCursor(nullptr),
+		rebalanceRank(0)
+		{
+
+		}
+
+	};
+
 	unsigned layerCount;
 	unsigned nodeCount;
 	unsigned layerCapacity;
+	unsigned rebalanceBudget;
 	SkipListIterator<Key, Value> itor;
+	Aggregate aggregator;
+	// True while the keys live in inlineEntries rather than in towers.
+	bool inlined;
+	// Null unless enableHashIndex() was called.
+	std::unique_ptr<SkipListHashIndex<Key, Value, Aggregate>> hashIndex;
+	// Small lists keep their keys here, sorted, with no nodes allocated at
+	// all (the sentinels included) until they outgrow it. The slots share
+	// their storage with the tower bookkeeping, so a towered list only pays
+	// for whatever they take beyond sizeof(Towers). They are capped at
+	// INLINE_BYTES, which keeps that excess small for wide entries: 16
+	// slots for <unsigned, unsigned> (no excess), 4 for <std::string,
+	// std::string> (136 bytes), never fewer than one. layerCount still
+	// tracks the lanes their towers would need, so numLayers() and
+	// height() read the same in either mode.
+	static const size_t INLINE_BYTES = 256;
+	static const unsigned INLINE_CAPACITY = std::min<size_t>(16, std::max<size_t>(1, INLINE_BYTES / sizeof(std::pair<Key, Value>)));
+	union
+	{
+		Towers towers;
+		std::pair<Key, Value> inlineEntries[INLINE_CAPACITY];
+	};
 
 public:
 
+	// A forward position on the bottom lane. seek() gallops through the
+	// towers from the current position instead of searching from topHead,
+	// so a run of increasing seeks costs O(log gap) each.
+	// Removing the key a cursor is on, or moving it away with splitAt or
+	// append, invalidates the cursor; other inserts and removals do not.
+	// While the list is small enough to be stored inline, though, any
+	// insert or removal invalidates its cursors.
+	class Cursor
+	{
+		
+		friend class SkipList;
+		
+	private:
+		
+		const SkipList* list;
+		// Null while the list is inline; *slot* is the position then.
+		SkipNode<Key, Value, Aggregate>* node;
+		unsigned slot;
+		
+		Cursor(const SkipList* list, SkipNode<Key, Value, Aggregate>* node):
+		list(list),
+		node(node),
+		slot(0)
+		{
+			
+		}
+		
+	public:
+		
+		// Is the cursor past the largest key?
+		bool atEnd() const { return node ? node->next == nullptr : slot >= list->nodeCount; }
+		
+		const Key & key() const { return node ? node->key : list->inlineEntries[slot].first; }
+		const Value & value() const { return node ? node->val : list->inlineEntries[slot].second; }
+		
+		void next()
+		{
+			if(atEnd()) return;
+			if(node) node = node->next;
+			else ++slot;
+		}
+		
+		// Move forward to the first key not less than *k*.
+		// Never moves backward.
+		void seek(const Key & k);
+		
+	};
+
 	SkipList();
 
 	// You DO NOT need to implement a copy constructor or an assignment operator.
@@ -268,6 +617,8 @@ public:
 	// [S_1]  -inf --------> inf
 	// [S_0]  -inf --> 0 --> inf
 	//
+	// Heights are set on insert (see there) and changed only by rebalance().
+	//
 	// Throw an exception if this key is not in the Skip List.
 	unsigned height(const Key & k) const;
 
@@ -294,17 +645,44 @@ public:
 	Value & find(const Key & k);
 	const Value & find(Key k) const;
 
+	// Replace the value associated with the given key, keeping the
+	// aggregates that cover it current. Writing through find() does not.
+	// Throw a RuntimeException if the key does not exist.
+	void update(const Key & k, const Value & v);
+
+	// Fold the values of every key in [lo, hi] with the Aggregate.
+	// Only available when the SkipList was given one, e.g.
+	// SkipList<unsigned, double, SumAggregate<double>>. Expected O(log n).
+	typename Aggregate::Type aggregate(const Key & lo, const Key & hi) const;
+
 	// Return true if this key/value pair is successfully inserted, false otherwise.
 	// See the project write-up for conditions under which the key should be "bubbled up"
 	// to the next layer.
 	// If the key already exists, do not insert one -- return false.
+	// Once the list holds CAPPED_TOWER_MIN_KEYS keys, the new tower also
+	// stops below the first lane holding more than half the keys of the
+	// lane beneath it, so heights then depend on the lanes as well as on
+	// the key (see towerFlips).
 	bool insert(const Key & k, const Value & v);
 
+	// Insert the key/value pairs of [first, last), which must be sorted by
+	// key, in one left-to-right pass: the per-lane predecessors move along
+	// with the batch instead of being searched for from topHead per key.
+	// Keys already present (or repeated in the batch) are skipped.
+	// Return how many pairs were inserted. Throw a RuntimeException, before
+	// inserting anything, if the batch is out of order.
+	template<typename ForwardIt>
+	size_t insertSortedBatch(ForwardIt first, ForwardIt last);
+
 
 	// Return a vector containing all inserted keys in increasing order.
 	std::vector<Key> allKeysInOrder() const;
 
 
+	// Return a cursor on the smallest key (or at the end if the list is empty).
+	Cursor cursor() const;
+
+
 	// Is this the smallest key in the SkipList? Throw a RuntimeException
 	// if the key *k* does not exist in the Skip List. 
 	bool isSmallestKey(const Key & k) const;
@@ -313,13 +691,129 @@ public:
 	// if the key *k* does not exist in the Skip List. 
 	bool isLargestKey(const Key & k) const;
 
-	// I am not requiring you to implement remove.
+	// Return the smallest / largest key in the SkipList.
+	// Throw a RuntimeException if the Skip List is empty.
+	Key min() const;
+	Key max() const;
+
+	// Remove this key and its whole tower.
+	// Return false if the key is not in the Skip List.
+	bool remove(const Key & k);
+
+	// Remove the smallest / largest key and return it with its value.
+	// The tower is unlinked straight from btmHead / btmRear without a search.
+	// Throw a RuntimeException if the Skip List is empty.
+	std::pair<Key, Value> popMin();
+	std::pair<Key, Value> popMax();
+
+	// Remove every key that is not greater than *k*, appending the
+	// key/value pairs to *out* in increasing order.
+	// Return how many pairs were removed.
+	size_t drainUntil(const Key & k, std::vector<std::pair<Key, Value>> & out);
+
+	// Call visit(key, value) for every key in [lo, hi], in increasing order.
+	template<typename Visitor>
+	void forEachInRange(const Key & lo, const Key & hi, Visitor visit) const;
+
+	// Move every key that is not less than *k* into *upper*, which must be empty.
+	// Whole lanes are spliced across; no node is copied or reallocated.
+	void splitAt(const Key & k, SkipList & upper);
+
+	// Move every key of *upper* to the end of this Skip List, leaving *upper* empty.
+	// Throw a RuntimeException unless all keys of *upper* are greater than ours.
+	void append(SkipList & upper);
+
+	// Reassign every tower the height its rank would have in a perfectly
+	// balanced skip list (1 + the number of trailing zero bits of the rank),
+	// in one O(n) pass over the bottom lane. Bottom nodes, and with them the
+	// keys and values, stay where they are; only upper lanes are relinked.
+	void rebalance();
+
+	// Re-level up to *towersPerInsert* towers on every insert, starting a new
+	// pass whenever needsRebalance() reports drift. Zero turns this off.
+	void setIncrementalRebalance(unsigned towersPerInsert);
+
+	// Do the lane populations stray far from the n / 2^i a balanced
+	// skip list would have on lane S_i?
+	bool needsRebalance() const;
+
+	// Keep a hash table from keys to bottom-lane nodes next to the lanes,
+	// so find, contains, update, height, nextKey and previousKey skip the
+	// O(log n) descent. It costs one pointer slot per key at a load factor
+	// of at most 1/2; disabling it frees the table. Needs std::hash<Key>.
+	void enableHashIndex(bool enable = true);
+
+	bool hasHashIndex() const noexcept;
+
+	// Is this key in the Skip List?
+	bool contains(const Key & k) const;
+
+	// Bytes held by the list itself: its nodes, sentinels and hash index,
+	// not counting anything the keys or values allocate on their own.
+	size_t memoryUsage() const;
 
 
 private:
-	SkipNode<Key, Value>* getNodePostion(const Key & k) const;
+	bool isInline() const noexcept;
+	
+	// Index of the first inline entry whose key is not less than *k*.
+	unsigned inlineLowerBound(const Key & k) const;
+	
+	// Index of the inline entry holding *k*, or nodeCount if there is none.
+	unsigned inlineFind(const Key & k) const;
+	
+	// Remove *count* inline entries starting at *first*.
+	void eraseInline(unsigned first, unsigned count);
+	
+	// Allocate the sentinels and move the inline entries into towers.
+	// Does nothing once the list has towers.
+	void promote();
+	
+	// How many times the coin comes up heads for *k*: one less than the
+	// height of its tower while the list is too small for towerFlips to
+	// cap it.
+	unsigned coinFlips(const Key & k) const;
+	
+	SkipNode<Key, Value, Aggregate>* getNodePostion(const Key & k) const;
+	
+	SkipNode<Key, Value, Aggregate>* getBottomNode(const Key & k) const;
+	
+	// Return the first bottom-lane node whose key is not less than *k*
+	// (btmRear if there is none). If *preds* is given, it receives the
+	// rightmost node smaller than *k* on every lane below the top one.
+	SkipNode<Key, Value, Aggregate>* lowerBoundNode(const Key & k, std::vector<SkipNode<Key, Value, Aggregate>*>* preds = nullptr) const;
+	
+	// Link a new tower for *k* right after predecessors[i] on each lane it
+	// reaches, adding lanes as needed, and leave predecessors pointing at
+	// the new nodes. Return the bottom node.
+	SkipNode<Key, Value, Aggregate>* spliceTower(const Key & k, const Value & v);
 	
-	void increaseLayerCapacity();
+	// Unlink and free a whole tower, handing back its key and value.
+	std::pair<Key, Value> removeTower(SkipNode<Key, Value, Aggregate>* btmNode);
+	
+	SkipNode<Key, Value, Aggregate>* laneHead(unsigned lane) const;
+	
+	void startRebalance();
+	
+	void stepRebalance(size_t count, bool refresh);
+	
+	void relevelTower(SkipNode<Key, Value, Aggregate>* btmNode, unsigned targetHeight);
+	
+	// Recompute the aggregates of every span that covers *btmNode*, and of
+	// the node just left of each on its lane, walking up from the bottom lane.
+	void refreshAggregates(SkipNode<Key, Value, Aggregate>* btmNode);
+	
+	// Refold the span of an upper-lane node from the lane below it.
+	void refoldSpan(SkipNode<Key, Value, Aggregate>* node);
+	
+	// Refold every upper-lane span, lane by lane, in O(number of nodes).
+	void rebuildAggregates();
+	
+	// Do all keys skipped by *node*'s link lie at or below *hi*?
+	bool spanEndsBy(SkipNode<Key, Value, Aggregate>* node, const Key & hi) const;
+	
+	// Size layerCapacity for a list of *keys* keys.
+	void increaseLayerCapacity(size_t keys);
 	
 	void addLayer();
 	
@@ -328,234 +822,1079 @@ private:
 	//void print();
 };
 
-template<typename Key, typename Value>
-SkipList<Key, Value>::SkipList():
-	topHead(new SkipNode<Key, Value>(MinLimits<Key>()())),
-	topRear(new SkipNode<Key, Value>(MaxLimits<Key>()())),
-	btmHead(new SkipNode<Key, Value>(MinLimits<Key>()())),
-	btmRear(new SkipNode<Key, Value>(MaxLimits<Key>()())),
+template<typename Key, typename Value, typename Aggregate>
+SkipList<Key, Value, Aggregate>::SkipList():
 	layerCount(2),
 	nodeCount(0),
-	layerCapacity(13)
+	layerCapacity(13),
+	rebalanceBudget(0),
+	inlined(true),
+	inlineEntries()
 {
-	topHead->next = topRear;
-	topRear->prev = topHead;
-	topHead->down = btmHead;
-	topRear->down = btmRear;
-	btmHead->next = btmRear;
-	btmRear->prev = btmHead;
-	btmHead->up = topHead;
-	btmRear->up = topRear;
+	
 }
 
-template<typename Key, typename Value>
-SkipList<Key, Value>::~SkipList()
+template<typename Key, typename Value, typename Aggregate>
+SkipList<Key, Value, Aggregate>::~SkipList()
 {
-	clear();
+	if(isInline())
+	{
+		std::destroy(std::begin(inlineEntries), std::end(inlineEntries));
+	}
+	else
+	{
+		clear();
+		towers.~Towers();
+	}
 }
 
-template<typename Key, typename Value>
-size_t SkipList<Key, Value>::size() const noexcept
+template<typename Key, typename Value, typename Aggregate>
+size_t SkipList<Key, Value, Aggregate>::size() const noexcept
 {
 	return nodeCount;
 }
 
-template<typename Key, typename Value>
-bool SkipList<Key, Value>::isEmpty() const noexcept
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::isEmpty() const noexcept
 {
-	return btmHead->next == btmRear;
+	if(isInline()) return nodeCount == 0;
+	return towers.btmHead->next == towers.btmRear;
 }
 
-template<typename Key, typename Value>
-unsigned SkipList<Key, Value>::numLayers() const noexcept
+template<typename Key, typename Value, typename Aggregate>
+unsigned SkipList<Key, Value, Aggregate>::numLayers() const noexcept
 {
 	return layerCount;
 }
 
-template<typename Key, typename Value>
-unsigned SkipList<Key, Value>::height(const Key & k) const
+template<typename Key, typename Value, typename Aggregate>
+unsigned SkipList<Key, Value, Aggregate>::height(const Key & k) const
 {
-	SkipNode<Key, Value>* current = getNodePostion(k);
+	if(isInline())
+	{
+		if(inlineFind(k) == nodeCount) throw RuntimeException("key is not in the Skip List");
+		return coinFlips(k) + 1;
+	}
+	SkipNode<Key, Value, Aggregate>* current = getBottomNode(k);
 	if(!current) throw RuntimeException("key is not in the Skip List");
 	unsigned currLayer = 1;
-	while(current->down != nullptr)
+	while(current->up != nullptr)
 	{
-		current = current->down;
+		current = current->up;
 		++currLayer;
 	}
 	return currLayer;
 }
 
-template<typename Key, typename Value>
-Key SkipList<Key, Value>::nextKey(const Key & k) const
+template<typename Key, typename Value, typename Aggregate>
+Key SkipList<Key, Value, Aggregate>::nextKey(const Key & k) const
 {
-	SkipNode<Key, Value>* current = getNodePostion(k);
-	if(!current) throw RuntimeException("key is not in the Skip List");
-	while(current->down)
+	if(isInline())
 	{
-		current = current->down;
+		unsigned i = inlineFind(k);
+		if(i == nodeCount) throw RuntimeException("key is not in the Skip List");
+		if(i + 1 == nodeCount) throw RuntimeException("k is the largest key in the Skip List.");
+		return inlineEntries[i + 1].first;
 	}
+	SkipNode<Key, Value, Aggregate>* current = getBottomNode(k);
+	if(!current) throw RuntimeException("key is not in the Skip List");
 	if(!current->next) throw RuntimeException("There is no subsequent key");
-	if(isLargestKey(k)) throw RuntimeException("k is the largest key in the Skip List.");
+	if(current->next == towers.btmRear) throw RuntimeException("k is the largest key in the Skip List.");
 	return current->next->key;
 }
 
-template<typename Key, typename Value>
-Key SkipList<Key, Value>::previousKey(const Key & k) const
+template<typename Key, typename Value, typename Aggregate>
+Key SkipList<Key, Value, Aggregate>::previousKey(const Key & k) const
 {
-	SkipNode<Key, Value>* current = getNodePostion(k);
-	if(!current) throw RuntimeException("key is not in the Skip List");
-	while(current->down)
+	if(isInline())
 	{
-		current = current->down;
+		unsigned i = inlineFind(k);
+		if(i == nodeCount) throw RuntimeException("key is not in the Skip List");
+		if(i == 0) throw RuntimeException("k is the smallest key in the Skip List.");
+		return inlineEntries[i - 1].first;
 	}
+	SkipNode<Key, Value, Aggregate>* current = getBottomNode(k);
+	if(!current) throw RuntimeException("key is not in the Skip List");
 	if(!current->prev) throw RuntimeException("There is no subsequent key");
-	if(isSmallestKey(k)) throw RuntimeException("k is the smallest key in the Skip List.");
+	if(current->prev == towers.btmHead) throw RuntimeException("k is the smallest key in the Skip List.");
 	return current->prev->key;
 }
 
-template<typename Key, typename Value>
-Value & SkipList<Key, Value>::find(const Key & k)
+template<typename Key, typename Value, typename Aggregate>
+Value & SkipList<Key, Value, Aggregate>::find(const Key & k)
 {
-	SkipNode<Key, Value>* current = getNodePostion(k);
+	if(isInline())
+	{
+		unsigned i = inlineFind(k);
+		if(i == nodeCount) throw RuntimeException("key is not in the Skip List");
+		return inlineEntries[i].second;
+	}
+	SkipNode<Key, Value, Aggregate>* current = getBottomNode(k);
 	if(!current) throw RuntimeException("key is not in the Skip List");
 	return current->val;
 }
 
-template<typename Key, typename Value>
-const Value & SkipList<Key, Value>::find(Key k) const
+template<typename Key, typename Value, typename Aggregate>
+const Value & SkipList<Key, Value, Aggregate>::find(Key k) const
 {
-	SkipNode<Key, Value>* current = getNodePostion(k);
+	if(isInline())
+	{
+		unsigned i = inlineFind(k);
+		if(i == nodeCount) throw RuntimeException("key is not in the Skip List");
+		return inlineEntries[i].second;
+	}
+	SkipNode<Key, Value, Aggregate>* current = getBottomNode(k);
 	if(!current) throw RuntimeException("key is not in the Skip List");
-	const Value result = current->val;
-	return result;
+	return current->val;
 }
 
-template<typename Key, typename Value>
-SkipNode<Key, Value>* SkipList<Key, Value>::getNodePostion(const Key & k) const
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::update(const Key & k, const Value & v)
 {
-	if(isEmpty()) return nullptr;
-	SkipNode<Key, Value>* current = topHead->down;
-	return itor.findNode(current, k, current);
-}
-
-template<typename Key, typename Value>
-bool SkipList<Key, Value>::insert(const Key & k, const Value & v)
-{
-	if(getNodePostion(k)) return false;
-	SkipNode<Key, Value>* newNode = nullptr;
-	SkipNode<Key, Value>* currentHead = btmHead;
-	SkipNode<Key, Value>* newNodeBtm = nullptr;
-	SkipNode<Key, Value>* current = nullptr;
-	int flipCoinCount = 0;
-	++nodeCount;
-	increaseLayerCapacity();
-	while(flipCoin(k, flipCoinCount) && flipCoinCount < layerCapacity-2)
+	if(isInline())
 	{
-		++flipCoinCount;
+		find(k) = v;
+		return;
 	}
-	if(flipCoinCount >= layerCount-1)
+	SkipNode<Key, Value, Aggregate>* current = getBottomNode(k);
+	if(!current) throw RuntimeException("key is not in the Skip List");
+	current->val = v;
+	refreshAggregates(current);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+typename Aggregate::Type SkipList<Key, Value, Aggregate>::aggregate(const Key & lo, const Key & hi) const
+{
+	static_assert(Aggregate::enabled, "aggregate() needs a SkipList declared with an Aggregate");
+	if constexpr(Aggregate::enabled)
 	{
-		int newLayerCount = flipCoinCount - (layerCount-1) + 1;
-		for(int i = 0; i < newLayerCount; ++i)
+		typename Aggregate::Type result = aggregator.identity();
+		if(isInline())
 		{
-			addLayer();
+			for(unsigned i = inlineLowerBound(lo); i < nodeCount && !itor.isFirstParameterGreater(inlineEntries[i].first, hi); ++i)
+			{
+				result = aggregator.combine(result, aggregator.lift(inlineEntries[i].second));
+			}
+			return result;
 		}
-	}
-	for(unsigned i = 0; i <= flipCoinCount; ++i)
-	{
-		current = currentHead->next;
-		newNode = new SkipNode<Key, Value>(k, v);
-		while(current->next != nullptr && itor.isFirstParameterGreater(k, current->key))
+		SkipNode<Key, Value, Aggregate>* current = lowerBoundNode(lo);
+		// Climb as high as a span still ends by *hi*, take that span whole,
+		// and drop back down once the next one would overshoot.
+		while(current->next != nullptr && !itor.isFirstParameterGreater(current->key, hi))
 		{
+			while(current->up && spanEndsBy(current->up, hi))
+			{
+				current = current->up;
+			}
+			while(current->down && !spanEndsBy(current, hi))
+			{
+				current = current->down;
+			}
+			result = aggregator.combine(result, current->agg);
 			current = current->next;
 		}
-		newNode->next = current;
-		current->prev->next = newNode;
-		newNode->prev = current->prev;
-		current->prev = newNode;
-		newNode->down = newNodeBtm;
-		if(newNodeBtm) newNodeBtm->up = newNode;
-		currentHead = currentHead->up;
-		newNodeBtm = newNode;
+		return result;
 	}
-	return true;
 }
 
-template<typename Key, typename Value>
-std::vector<Key> SkipList<Key, Value>::allKeysInOrder() const
+template<typename Key, typename Value, typename Aggregate>
+SkipNode<Key, Value, Aggregate>* SkipList<Key, Value, Aggregate>::getNodePostion(const Key & k) const
 {
-	// you are allowed to use a std::vector in this function.
-	if(isEmpty()) return {};
-	std::vector<Key> r;
-	r.reserve(nodeCount);
-	SkipNode<Key, Value>* current = btmHead->next;
-	while(current != btmRear)
-	{
-		r.push_back(current->key);
-		current = current->next;
-	}
+	if(isEmpty()) return nullptr;
+	SkipNode<Key, Value, Aggregate>* current = towers.topHead->down;
+	return itor.findNode(current, k, current);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+SkipNode<Key, Value, Aggregate>* SkipList<Key, Value, Aggregate>::getBottomNode(const Key & k) const
+{
+	if(hashIndex) return hashIndex->find(k);
+	SkipNode<Key, Value, Aggregate>* current = getNodePostion(k);
+	if(!current) return nullptr;
+	while(current->down)
+	{
+		current = current->down;
+	}
+	// The sentinels carry keys too (numeric max, or "" for strings), so a
+	// lookup for that key can land on one. It is never a stored key.
+	if(current == towers.btmHead || current == towers.btmRear) return nullptr;
+	return current;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+SkipNode<Key, Value, Aggregate>* SkipList<Key, Value, Aggregate>::lowerBoundNode(const Key & k, std::vector<SkipNode<Key, Value, Aggregate>*>* preds) const
+{
+	if(preds) preds->resize(layerCount - 1);
+	SkipNode<Key, Value, Aggregate>* current = towers.topHead->down;
+	for(unsigned level = layerCount - 1; level-- > 0;)
+	{
+		while(current->next->next != nullptr && itor.isFirstParameterGreater(k, current->next->key))
+		{
+			current = current->next;
+		}
+		if(preds) (*preds)[level] = current;
+		if(current->down) current = current->down;
+	}
+	return current->next;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::insert(const Key & k, const Value & v)
+{
+	if(isInline())
+	{
+		unsigned i = inlineLowerBound(k);
+		if(i < nodeCount && inlineEntries[i].first == k) return false;
+		if(nodeCount < INLINE_CAPACITY)
+		{
+			std::move_backward(inlineEntries + i, inlineEntries + nodeCount, inlineEntries + nodeCount + 1);
+			inlineEntries[i] = std::pair<Key, Value>(k, v);
+			++nodeCount;
+			layerCount = std::max(layerCount, coinFlips(k) + 2);
+			return true;
+		}
+		promote();
+	}
+	// With an index, duplicates are turned away before the descent.
+	if(hashIndex && hashIndex->find(k)) return false;
+	SkipNode<Key, Value, Aggregate>* successor = lowerBoundNode(k, &towers.predecessors);
+	if(successor != towers.btmRear && successor->key == k) return false;
+	++nodeCount;
+	increaseLayerCapacity(nodeCount);
+	refreshAggregates(spliceTower(k, v));
+	if(towers.rebalanceCursor && towers.rebalanceCursor != towers.btmRear && itor.isFirstParameterGreater(towers.rebalanceCursor->key, k)) ++towers.rebalanceRank;
+	if(rebalanceBudget)
+	{
+		if(!towers.rebalanceCursor && needsRebalance()) startRebalance();
+		stepRebalance(rebalanceBudget, true);
+	}
+	return true;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+template<typename ForwardIt>
+size_t SkipList<Key, Value, Aggregate>::insertSortedBatch(ForwardIt first, ForwardIt last)
+{
+	if(first == last) return 0;
+	size_t batchSize = 1;
+	for(ForwardIt prev = first, it = std::next(first); it != last; prev = it, ++it, ++batchSize)
+	{
+		if(itor.isFirstParameterGreater(prev->first, it->first))
+		{
+			throw RuntimeException("batch keys must be in increasing order");
+		}
+	}
+	if(isInline())
+	{
+		if(nodeCount + batchSize <= INLINE_CAPACITY)
+		{
+			size_t inserted = 0;
+			for(; first != last; ++first)
+			{
+				inserted += insert(first->first, first->second);
+			}
+			return inserted;
+		}
+		promote();
+	}
+	// A running re-leveling pass would need its rank adjusted per key; restart it instead.
+	towers.rebalanceCursor = nullptr;
+	increaseLayerCapacity(nodeCount + batchSize);
+	// Refreshing aggregates costs O(log n) per key; past a point one rebuild is cheaper.
+	bool rebuild = Aggregate::enabled && batchSize * layerCount > nodeCount;
+	lowerBoundNode(first->first, &towers.predecessors);
+	size_t inserted = 0;
+	for(ForwardIt prev = last; first != last; prev = first, ++first)
+	{
+		const Key & k = first->first;
+		if(prev != last && prev->first == k) continue;
+		// predecessors hold the rightmost nodes below the previous key. Only the
+		// lanes whose next node is now also below *k* move, and those are found
+		// by climbing from the bottom, so a short gap costs a short search.
+		unsigned top = 0;
+		while(top < towers.predecessors.size() && towers.predecessors[top]->next->next != nullptr && itor.isFirstParameterGreater(k, towers.predecessors[top]->next->key))
+		{
+			++top;
+		}
+		SkipNode<Key, Value, Aggregate>* current = nullptr;
+		for(unsigned level = top; level-- > 0;)
+		{
+			current = current ? current->down : towers.predecessors[level];
+			while(current->next->next != nullptr && itor.isFirstParameterGreater(k, current->next->key))
+			{
+				current = current->next;
+			}
+			towers.predecessors[level] = current;
+		}
+		SkipNode<Key, Value, Aggregate>* successor = towers.predecessors[0]->next;
+		if(successor != towers.btmRear && successor->key == k) continue;
+		++nodeCount;
+		++inserted;
+		SkipNode<Key, Value, Aggregate>* newNode = spliceTower(k, first->second);
+		if(!rebuild) refreshAggregates(newNode);
+	}
+	if(rebuild) rebuildAggregates();
+	if(rebalanceBudget && needsRebalance())
+	{
+		startRebalance();
+		stepRebalance(rebalanceBudget * inserted, true);
+	}
+	return inserted;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+SkipNode<Key, Value, Aggregate>* SkipList<Key, Value, Aggregate>::spliceTower(const Key & k, const Value & v)
+{
+	SkipNode<Key, Value, Aggregate>* newNode = nullptr;
+	SkipNode<Key, Value, Aggregate>* currentHead = towers.btmHead;
+	SkipNode<Key, Value, Aggregate>* newNodeBtm = nullptr;
+	SkipNode<Key, Value, Aggregate>* previous = nullptr;
+	unsigned flipCoinCount = towerFlips(k, layerCapacity, [this](unsigned lane) -> size_t
+	{
+		return lane < towers.laneCounts.size() ? towers.laneCounts[lane] : 0;
+	});
+	if(flipCoinCount >= layerCount-1)
+	{
+		unsigned newLayerCount = flipCoinCount - (layerCount-1) + 1;
+		for(unsigned i = 0; i < newLayerCount; ++i)
+		{
+			addLayer();
+		}
+	}
+	for(unsigned i = 0; i <= flipCoinCount; ++i)
+	{
+		// Lanes added above have no predecessor recorded; their head is it.
+		previous = i < towers.predecessors.size() ? towers.predecessors[i] : currentHead;
+		// Only the bottom lane carries the value; upper lanes are for searching.
+		newNode = i == 0 ? new SkipNode<Key, Value, Aggregate>(k, v) : new SkipNode<Key, Value, Aggregate>(k);
+		newNode->next = previous->next;
+		newNode->prev = previous;
+		previous->next->prev = newNode;
+		previous->next = newNode;
+		newNode->down = newNodeBtm;
+		if(newNodeBtm) newNodeBtm->up = newNode;
+		if(i < towers.predecessors.size()) towers.predecessors[i] = newNode;
+		else towers.predecessors.push_back(newNode);
+		currentHead = currentHead->up;
+		newNodeBtm = newNode;
+		++towers.laneCounts[i];
+	}
+	SkipNode<Key, Value, Aggregate>* btmNode = towers.predecessors[0];
+	if(hashIndex) hashIndex->insert(btmNode);
+	return btmNode;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+std::vector<Key> SkipList<Key, Value, Aggregate>::allKeysInOrder() const
+{
+	// you are allowed to use a std::vector in this function.
+	if(isEmpty()) return {};
+	std::vector<Key> r;
+	r.reserve(nodeCount);
+	if(isInline())
+	{
+		for(unsigned i = 0; i < nodeCount; ++i)
+		{
+			r.push_back(inlineEntries[i].first);
+		}
+		return r;
+	}
+	SkipNode<Key, Value, Aggregate>* current = towers.btmHead->next;
+	while(current != towers.btmRear)
+	{
+		r.push_back(current->key);
+		current = current->next;
+	}
 	return r;
 }
 
-template<typename Key, typename Value>
-bool SkipList<Key, Value>::isSmallestKey(const Key & k) const
+template<typename Key, typename Value, typename Aggregate>
+typename SkipList<Key, Value, Aggregate>::Cursor SkipList<Key, Value, Aggregate>::cursor() const
+{
+	return Cursor(this, isInline() ? nullptr : towers.btmHead->next);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::Cursor::seek(const Key & k)
+{
+	if(!node)
+	{
+		while(!atEnd() && list->itor.isFirstParameterGreater(k, key()))
+		{
+			++slot;
+		}
+		return;
+	}
+	if(atEnd() || !list->itor.isFirstParameterGreater(k, node->key)) return;
+	// Climb while the next node on the current lane still falls short of *k*,
+	// stepping right along lanes whose tower ends here.
+	SkipNode<Key, Value, Aggregate>* current = node;
+	while(current->next->next != nullptr && list->itor.isFirstParameterGreater(k, current->next->key))
+	{
+		current = current->up ? current->up : current->next;
+	}
+	// Then search down from there as usual.
+	while(true)
+	{
+		while(current->next->next != nullptr && list->itor.isFirstParameterGreater(k, current->next->key))
+		{
+			current = current->next;
+		}
+		if(!current->down) break;
+		current = current->down;
+	}
+	node = current->next;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::isSmallestKey(const Key & k) const
 {
-	if(!getNodePostion(k)) throw RuntimeException("key is not in the Skip List");
-	if(btmHead->next->key == k) return true;
+	if(isInline())
+	{
+		unsigned i = inlineFind(k);
+		if(i == nodeCount) throw RuntimeException("key is not in the Skip List");
+		return i == 0;
+	}
+	if(!getBottomNode(k)) throw RuntimeException("key is not in the Skip List");
+	if(towers.btmHead->next->key == k) return true;
 	return false;
 	
 }
 
-template<typename Key, typename Value>
-bool SkipList<Key, Value>::isLargestKey(const Key & k) const
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::isLargestKey(const Key & k) const
 {
-	if(!getNodePostion(k)) throw RuntimeException("key is not in the Skip List");
-	if(btmRear->prev->key == k) return true;
+	if(isInline())
+	{
+		unsigned i = inlineFind(k);
+		if(i == nodeCount) throw RuntimeException("key is not in the Skip List");
+		return i + 1 == nodeCount;
+	}
+	if(!getBottomNode(k)) throw RuntimeException("key is not in the Skip List");
+	if(towers.btmRear->prev->key == k) return true;
 	return false;
 }
 
-template<typename Key, typename Value>
-void SkipList<Key, Value>::increaseLayerCapacity()
+template<typename Key, typename Value, typename Aggregate>
+Key SkipList<Key, Value, Aggregate>::min() const
 {
-	if(nodeCount <= 16) return;
-	layerCapacity = 3 * std::ceil(std::log2(nodeCount)) + 1;
+	if(isEmpty()) throw RuntimeException("Skip List is empty");
+	if(isInline()) return inlineEntries[0].first;
+	return towers.btmHead->next->key;
 }
 
-template<typename Key, typename Value>
-void SkipList<Key, Value>::addLayer()
+template<typename Key, typename Value, typename Aggregate>
+Key SkipList<Key, Value, Aggregate>::max() const
+{
+	if(isEmpty()) throw RuntimeException("Skip List is empty");
+	if(isInline()) return inlineEntries[nodeCount - 1].first;
+	return towers.btmRear->prev->key;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::remove(const Key & k)
+{
+	if(isInline())
+	{
+		unsigned i = inlineFind(k);
+		if(i == nodeCount) return false;
+		eraseInline(i, 1);
+		return true;
+	}
+	SkipNode<Key, Value, Aggregate>* current = getBottomNode(k);
+	if(!current) return false;
+	removeTower(current);
+	return true;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+std::pair<Key, Value> SkipList<Key, Value, Aggregate>::popMin()
+{
+	if(isEmpty()) throw RuntimeException("Skip List is empty");
+	if(isInline())
+	{
+		std::pair<Key, Value> result = std::move(inlineEntries[0]);
+		eraseInline(0, 1);
+		return result;
+	}
+	return removeTower(towers.btmHead->next);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+std::pair<Key, Value> SkipList<Key, Value, Aggregate>::popMax()
+{
+	if(isEmpty()) throw RuntimeException("Skip List is empty");
+	if(isInline())
+	{
+		std::pair<Key, Value> result = std::move(inlineEntries[nodeCount - 1]);
+		eraseInline(nodeCount - 1, 1);
+		return result;
+	}
+	return removeTower(towers.btmRear->prev);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+size_t SkipList<Key, Value, Aggregate>::drainUntil(const Key & k, std::vector<std::pair<Key, Value>> & out)
+{
+	size_t drained = 0;
+	if(isInline())
+	{
+		while(drained < nodeCount && !itor.isFirstParameterGreater(inlineEntries[drained].first, k))
+		{
+			out.push_back(std::move(inlineEntries[drained]));
+			++drained;
+		}
+		eraseInline(0, drained);
+		return drained;
+	}
+	while(!isEmpty() && !itor.isFirstParameterGreater(towers.btmHead->next->key, k))
+	{
+		out.push_back(removeTower(towers.btmHead->next));
+		++drained;
+	}
+	return drained;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+template<typename Visitor>
+void SkipList<Key, Value, Aggregate>::forEachInRange(const Key & lo, const Key & hi, Visitor visit) const
+{
+	if(isInline())
+	{
+		for(unsigned i = inlineLowerBound(lo); i < nodeCount && !itor.isFirstParameterGreater(inlineEntries[i].first, hi); ++i)
+		{
+			visit(inlineEntries[i].first, inlineEntries[i].second);
+		}
+		return;
+	}
+	SkipNode<Key, Value, Aggregate>* current = lowerBoundNode(lo);
+	while(current != towers.btmRear && !itor.isFirstParameterGreater(current->key, hi))
+	{
+		visit(current->key, current->val);
+		current = current->next;
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::splitAt(const Key & k, SkipList & upper)
 {
-	SkipNode<Key, Value>* newLayerHead = new SkipNode<Key, Value>(MinLimits<Key>()());
-	SkipNode<Key, Value>* newLayerRear = new SkipNode<Key, Value>(MaxLimits<Key>()());
+	if(!upper.isEmpty()) throw RuntimeException("target Skip List is not empty");
+	if(isInline())
+	{
+		unsigned i = inlineLowerBound(k);
+		for(unsigned j = i; j < nodeCount; ++j)
+		{
+			upper.insert(inlineEntries[j].first, inlineEntries[j].second);
+		}
+		eraseInline(i, nodeCount - i);
+		return;
+	}
+	upper.promote();
+	towers.rebalanceCursor = nullptr;
+	while(upper.layerCount < layerCount)
+	{
+		upper.addLayer();
+	}
+	lowerBoundNode(k, &towers.predecessors);
+	SkipNode<Key, Value, Aggregate>* rear = towers.btmRear;
+	SkipNode<Key, Value, Aggregate>* upperFirstHead = upper.towers.btmHead;
+	SkipNode<Key, Value, Aggregate>* upperRear = upper.towers.btmRear;
+	for(unsigned i = 0; i < towers.predecessors.size(); ++i)
+	{
+		SkipNode<Key, Value, Aggregate>* first = towers.predecessors[i]->next;
+		if(first != rear)
+		{
+			SkipNode<Key, Value, Aggregate>* last = rear->prev;
+			towers.predecessors[i]->next = rear;
+			rear->prev = towers.predecessors[i];
+			upperFirstHead->next = first;
+			first->prev = upperFirstHead;
+			last->next = upperRear;
+			upperRear->prev = last;
+		}
+		rear = rear->up;
+		upperFirstHead = upperFirstHead->up;
+		upperRear = upperRear->up;
+	}
+	SkipNode<Key, Value, Aggregate>* upperHead = upper.towers.btmHead;
+	for(unsigned lane = 0; lane < towers.laneCounts.size(); ++lane, upperHead = upperHead->up)
+	{
+		for(SkipNode<Key, Value, Aggregate>* current = upperHead->next; current->next != nullptr; current = current->next)
+		{
+			++upper.towers.laneCounts[lane];
+		}
+		towers.laneCounts[lane] -= upper.towers.laneCounts[lane];
+	}
+	upper.nodeCount = upper.towers.laneCounts[0];
+	nodeCount -= upper.nodeCount;
+	if(hashIndex || upper.hashIndex)
+	{
+		for(SkipNode<Key, Value, Aggregate>* current = upper.towers.btmHead->next; current != upper.towers.btmRear; current = current->next)
+		{
+			if(hashIndex) hashIndex->erase(current);
+			if(upper.hashIndex) upper.hashIndex->insert(current);
+		}
+	}
+	upper.increaseLayerCapacity(upper.nodeCount);
+	refreshAggregates(towers.btmRear->prev);
+	upper.refreshAggregates(upper.towers.btmHead);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::append(SkipList & upper)
+{
+	if(upper.isEmpty()) return;
+	if(!isEmpty() && !itor.isFirstParameterGreater(upper.min(), max()))
+	{
+		throw RuntimeException("appended keys must be greater than every existing key");
+	}
+	if(isInline() && upper.isInline() && nodeCount + upper.nodeCount <= INLINE_CAPACITY)
+	{
+		std::move(upper.inlineEntries, upper.inlineEntries + upper.nodeCount, inlineEntries + nodeCount);
+		nodeCount += upper.nodeCount;
+		layerCount = std::max(layerCount, upper.layerCount);
+		upper.eraseInline(0, upper.nodeCount);
+		return;
+	}
+	promote();
+	upper.promote();
+	towers.rebalanceCursor = nullptr;
+	while(layerCount < upper.layerCount)
+	{
+		addLayer();
+	}
+	for(unsigned lane = 0; lane < upper.towers.laneCounts.size(); ++lane)
+	{
+		towers.laneCounts[lane] += upper.towers.laneCounts[lane];
+		upper.towers.laneCounts[lane] = 0;
+	}
+	if(hashIndex)
+	{
+		for(SkipNode<Key, Value, Aggregate>* current = upper.towers.btmHead->next; current != upper.towers.btmRear; current = current->next)
+		{
+			hashIndex->insert(current);
+		}
+	}
+	if(upper.hashIndex) upper.hashIndex.reset(new SkipListHashIndex<Key, Value, Aggregate>());
+	SkipNode<Key, Value, Aggregate>* oldLast = towers.btmRear->prev;
+	SkipNode<Key, Value, Aggregate>* rear = towers.btmRear;
+	SkipNode<Key, Value, Aggregate>* upperHead = upper.towers.btmHead;
+	SkipNode<Key, Value, Aggregate>* upperRear = upper.towers.btmRear;
+	while(upperHead != upper.towers.topHead)
+	{
+		SkipNode<Key, Value, Aggregate>* first = upperHead->next;
+		if(first != upperRear)
+		{
+			SkipNode<Key, Value, Aggregate>* last = upperRear->prev;
+			rear->prev->next = first;
+			first->prev = rear->prev;
+			last->next = rear;
+			rear->prev = last;
+			upperHead->next = upperRear;
+			upperRear->prev = upperHead;
+		}
+		rear = rear->up;
+		upperHead = upperHead->up;
+		upperRear = upperRear->up;
+	}
+	nodeCount += upper.nodeCount;
+	upper.nodeCount = 0;
+	increaseLayerCapacity(nodeCount);
+	refreshAggregates(oldLast);
+	upper.refreshAggregates(upper.towers.btmHead);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+std::pair<Key, Value> SkipList<Key, Value, Aggregate>::removeTower(SkipNode<Key, Value, Aggregate>* btmNode)
+{
+	// Keep a running re-leveling pass pointing at live nodes.
+	if(towers.rebalanceCursor == btmNode) towers.rebalanceCursor = btmNode->next;
+	else if(towers.rebalanceCursor && towers.rebalanceCursor != towers.btmRear && itor.isFirstParameterGreater(towers.rebalanceCursor->key, btmNode->key)) --towers.rebalanceRank;
+	if(hashIndex) hashIndex->erase(btmNode);
+	std::pair<Key, Value> result(std::move(btmNode->key), std::move(btmNode->val));
+	SkipNode<Key, Value, Aggregate>* left = btmNode->prev;
+	SkipNode<Key, Value, Aggregate>* current = btmNode;
+	for(unsigned lane = 0; current; ++lane)
+	{
+		SkipNode<Key, Value, Aggregate>* up = current->up;
+		if(lane < towers.rebalanceLast.size() && towers.rebalanceLast[lane] == current) towers.rebalanceLast[lane] = current->prev;
+		current->prev->next = current->next;
+		current->next->prev = current->prev;
+		--towers.laneCounts[lane];
+		delete current;
+		current = up;
+	}
+	--nodeCount;
+	refreshAggregates(left);
+	return result;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::rebalance()
+{
+	promote();
+	startRebalance();
+	stepRebalance(nodeCount + 1, false);
+	rebuildAggregates();
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::setIncrementalRebalance(unsigned towersPerInsert)
+{
+	rebalanceBudget = towersPerInsert;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::needsRebalance() const
+{
+	if(isInline()) return false;
+	// Lane S_i should hold about n / 2^i keys. Sparse lanes are held to a
+	// small absolute slack so the odd tall tower does not trigger a pass.
+	// nodeCount is widened before the shift: lists can hold more than 32
+	// lanes, and shifting an unsigned by its width or more is undefined.
+	for(unsigned lane = 1; lane < 8 * sizeof(size_t); ++lane)
+	{
+		size_t expected = static_cast<size_t>(nodeCount) >> lane;
+		if(lane >= towers.laneCounts.size() && expected < 8) break;
+		size_t count = lane < towers.laneCounts.size() ? towers.laneCounts[lane] : 0;
+		if(count > 4 * expected + 8) return true;
+		if(expected >= 8 && count < expected / 4) return true;
+	}
+	return false;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+SkipNode<Key, Value, Aggregate>* SkipList<Key, Value, Aggregate>::laneHead(unsigned lane) const
+{
+	SkipNode<Key, Value, Aggregate>* current = towers.btmHead;
+	for(unsigned i = 0; i < lane; ++i)
+	{
+		current = current->up;
+	}
+	return current;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::startRebalance()
+{
+	towers.rebalanceCursor = towers.btmHead->next;
+	towers.rebalanceRank = 1;
+	towers.rebalanceLast.clear();
+	for(SkipNode<Key, Value, Aggregate>* current = towers.btmHead; current != towers.topHead; current = current->up)
+	{
+		towers.rebalanceLast.push_back(current);
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::stepRebalance(size_t count, bool refresh)
+{
+	for(; towers.rebalanceCursor && count > 0; --count)
+	{
+		if(towers.rebalanceCursor == towers.btmRear)
+		{
+			towers.rebalanceCursor = nullptr;
+			return;
+		}
+		unsigned targetHeight = 1;
+		for(size_t rank = towers.rebalanceRank; rank > 0 && rank % 2 == 0 && targetHeight < layerCapacity - 1; rank /= 2)
+		{
+			++targetHeight;
+		}
+		relevelTower(towers.rebalanceCursor, targetHeight);
+		if(refresh) refreshAggregates(towers.rebalanceCursor);
+		towers.rebalanceCursor = towers.rebalanceCursor->next;
+		++towers.rebalanceRank;
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::relevelTower(SkipNode<Key, Value, Aggregate>* btmNode, unsigned targetHeight)
+{
+	SkipNode<Key, Value, Aggregate>* top = btmNode;
+	unsigned currentHeight = 1;
+	while(top->up)
+	{
+		top = top->up;
+		++currentHeight;
+	}
+	for(; currentHeight > targetHeight; --currentHeight)
+	{
+		SkipNode<Key, Value, Aggregate>* below = top->down;
+		top->prev->next = top->next;
+		top->next->prev = top->prev;
+		below->up = nullptr;
+		--towers.laneCounts[currentHeight - 1];
+		delete top;
+		top = below;
+	}
+	while(layerCount < targetHeight + 1)
+	{
+		addLayer();
+	}
+	while(towers.rebalanceLast.size() < layerCount - 1)
+	{
+		towers.rebalanceLast.push_back(laneHead(towers.rebalanceLast.size()));
+	}
+	for(; currentHeight < targetHeight; ++currentHeight)
+	{
+		// Inserts made since the pass went by may sit between the last
+		// re-leveled tower and this one.
+		SkipNode<Key, Value, Aggregate>* previous = towers.rebalanceLast[currentHeight];
+		while(previous->next->next != nullptr && itor.isFirstParameterGreater(btmNode->key, previous->next->key))
+		{
+			previous = previous->next;
+		}
+		SkipNode<Key, Value, Aggregate>* newNode = new SkipNode<Key, Value, Aggregate>(btmNode->key);
+		newNode->next = previous->next;
+		newNode->prev = previous;
+		previous->next->prev = newNode;
+		previous->next = newNode;
+		newNode->down = top;
+		top->up = newNode;
+		++towers.laneCounts[currentHeight];
+		top = newNode;
+	}
+	for(unsigned lane = targetHeight; lane-- > 0; top = top->down)
+	{
+		towers.rebalanceLast[lane] = top;
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::refreshAggregates(SkipNode<Key, Value, Aggregate>* btmNode)
+{
+	if constexpr(Aggregate::enabled)
+	{
+		SkipNode<Key, Value, Aggregate>* current = btmNode;
+		if(current != towers.btmHead) current->agg = aggregator.lift(current->val);
+		while(true)
+		{
+			while(current->up == nullptr && current->prev != nullptr)
+			{
+				current = current->prev;
+			}
+			if(current->up == nullptr) break;
+			current = current->up;
+			if(current->prev) refoldSpan(current->prev);
+			refoldSpan(current);
+		}
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::refoldSpan(SkipNode<Key, Value, Aggregate>* node)
+{
+	if constexpr(Aggregate::enabled)
+	{
+		typename Aggregate::Type result = aggregator.identity();
+		for(SkipNode<Key, Value, Aggregate>* current = node->down; current != node->next->down; current = current->next)
+		{
+			result = aggregator.combine(result, current->agg);
+		}
+		node->agg = result;
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::rebuildAggregates()
+{
+	if constexpr(Aggregate::enabled)
+	{
+		for(SkipNode<Key, Value, Aggregate>* current = towers.btmHead->next; current != towers.btmRear; current = current->next)
+		{
+			current->agg = aggregator.lift(current->val);
+		}
+		for(SkipNode<Key, Value, Aggregate>* head = towers.btmHead->up; head; head = head->up)
+		{
+			for(SkipNode<Key, Value, Aggregate>* current = head; current->next; current = current->next)
+			{
+				refoldSpan(current);
+			}
+		}
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::spanEndsBy(SkipNode<Key, Value, Aggregate>* node, const Key & hi) const
+{
+	if(node->next->next == nullptr) return !itor.isFirstParameterGreater(towers.btmRear->prev->key, hi);
+	return !itor.isFirstParameterGreater(node->next->key, hi);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::enableHashIndex(bool enable)
+{
+	if(!enable)
+	{
+		hashIndex.reset();
+		return;
+	}
+	if(hashIndex) return;
+	// The index points at nodes, so inline entries move into towers first.
+	promote();
+	hashIndex.reset(new SkipListHashIndex<Key, Value, Aggregate>());
+	for(SkipNode<Key, Value, Aggregate>* current = towers.btmHead->next; current != towers.btmRear; current = current->next)
+	{
+		hashIndex->insert(current);
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::hasHashIndex() const noexcept
+{
+	return hashIndex != nullptr;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::contains(const Key & k) const
+{
+	if(isInline()) return inlineFind(k) != nodeCount;
+	return getBottomNode(k) != nullptr;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+size_t SkipList<Key, Value, Aggregate>::memoryUsage() const
+{
+	if(isInline()) return sizeof(*this);
+	size_t nodes = 2 * layerCount;
+	for(size_t laneCount : towers.laneCounts)
+	{
+		nodes += laneCount;
+	}
+	size_t bytes = sizeof(*this) + nodes * sizeof(SkipNode<Key, Value, Aggregate>);
+	bytes += (towers.predecessors.capacity() + towers.rebalanceLast.capacity()) * sizeof(SkipNode<Key, Value, Aggregate>*);
+	bytes += towers.laneCounts.capacity() * sizeof(size_t);
+	if(hashIndex) bytes += hashIndex->memoryUsage();
+	return bytes;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+bool SkipList<Key, Value, Aggregate>::isInline() const noexcept
+{
+	return inlined;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+unsigned SkipList<Key, Value, Aggregate>::inlineLowerBound(const Key & k) const
+{
+	// A linear scan: at most INLINE_CAPACITY keys, all in one block of memory.
+	unsigned i = 0;
+	while(i < nodeCount && itor.isFirstParameterGreater(k, inlineEntries[i].first))
+	{
+		++i;
+	}
+	return i;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+unsigned SkipList<Key, Value, Aggregate>::inlineFind(const Key & k) const
+{
+	unsigned i = inlineLowerBound(k);
+	if(i < nodeCount && inlineEntries[i].first == k) return i;
+	return nodeCount;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::eraseInline(unsigned first, unsigned count)
+{
+	// With nothing to erase the move below would self-assign every entry,
+	// which may leave a string key moved-from.
+	if(count == 0) return;
+	std::move(inlineEntries + first + count, inlineEntries + nodeCount, inlineEntries + first);
+	nodeCount -= count;
+	// Release whatever the vacated slots still hold.
+	for(unsigned i = nodeCount; i < nodeCount + count; ++i)
+	{
+		inlineEntries[i] = std::pair<Key, Value>();
+	}
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::promote()
+{
+	if(!isInline()) return;
+	// The towers take over the storage of the slots, so move the entries out first.
+	std::vector<std::pair<Key, Value>> entries(std::make_move_iterator(inlineEntries), std::make_move_iterator(inlineEntries + nodeCount));
+	std::destroy(std::begin(inlineEntries), std::end(inlineEntries));
+	new (&towers) Towers();
+	inlined = false;
+	towers.topHead = new SkipNode<Key, Value, Aggregate>(MinLimits<Key>()());
+	towers.topRear = new SkipNode<Key, Value, Aggregate>(MaxLimits<Key>()());
+	towers.btmHead = new SkipNode<Key, Value, Aggregate>(MinLimits<Key>()());
+	towers.btmRear = new SkipNode<Key, Value, Aggregate>(MaxLimits<Key>()());
+	towers.topHead->next = towers.topRear;
+	towers.topRear->prev = towers.topHead;
+	towers.topHead->down = towers.btmHead;
+	towers.topRear->down = towers.btmRear;
+	towers.btmHead->next = towers.btmRear;
+	towers.btmRear->prev = towers.btmHead;
+	towers.btmHead->up = towers.topHead;
+	towers.btmRear->up = towers.topRear;
+	unsigned lanesNeeded = layerCount;
+	layerCount = 2;
+	towers.laneCounts.assign(1, 0);
+	// Entries are in order, so each tower goes right after the last one.
+	towers.predecessors.assign(1, towers.btmHead);
+	for(const std::pair<Key, Value> & entry : entries)
+	{
+		spliceTower(entry.first, entry.second);
+	}
+	// Lanes are never taken away, so keep those of keys removed while inline.
+	while(layerCount < lanesNeeded)
+	{
+		addLayer();
+	}
+	rebuildAggregates();
+}
+
+template<typename Key, typename Value, typename Aggregate>
+unsigned SkipList<Key, Value, Aggregate>::coinFlips(const Key & k) const
+{
+	return keyFlips(k, layerCapacity);
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::increaseLayerCapacity(size_t keys)
+{
+	if(keys <= 16) return;
+	layerCapacity = 3 * std::ceil(std::log2(keys)) + 1;
+}
+
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::addLayer()
+{
+	SkipNode<Key, Value, Aggregate>* newLayerHead = new SkipNode<Key, Value, Aggregate>(MinLimits<Key>()());
+	SkipNode<Key, Value, Aggregate>* newLayerRear = new SkipNode<Key, Value, Aggregate>(MaxLimits<Key>()());
 	newLayerHead->next = newLayerRear;
 	newLayerRear->prev = newLayerHead;
-	topHead->down->up = newLayerHead;
-	newLayerHead->down = topHead->down;
-	topHead->down = newLayerHead;
-	newLayerHead->up = topHead;
-	topRear->down->up = newLayerRear;
-	newLayerRear->down = topRear->down;
-	topRear->down = newLayerRear;
-	newLayerRear->up = topRear;
+	towers.topHead->down->up = newLayerHead;
+	newLayerHead->down = towers.topHead->down;
+	towers.topHead->down = newLayerHead;
+	newLayerHead->up = towers.topHead;
+	towers.topRear->down->up = newLayerRear;
+	newLayerRear->down = towers.topRear->down;
+	towers.topRear->down = newLayerRear;
+	newLayerRear->up = towers.topRear;
 	++layerCount;
+	towers.laneCounts.push_back(0);
 }
 
-template<typename Key, typename Value>
-void SkipList<Key, Value>::clear()
+template<typename Key, typename Value, typename Aggregate>
+void SkipList<Key, Value, Aggregate>::clear()
 {
-	if(isEmpty()) return;
-	while(topHead != nullptr)
+	while(towers.topHead != nullptr)
 	{
-		SkipNode<Key, Value>* current = nullptr;
-		SkipNode<Key, Value>* topHeadDown = topHead->down;
-		while(topHead != nullptr)
+		SkipNode<Key, Value, Aggregate>* current = nullptr;
+		SkipNode<Key, Value, Aggregate>* topHeadDown = towers.topHead->down;
+		while(towers.topHead != nullptr)
 		{
-			current = topHead;
-			topHead = current->next;
+			current = towers.topHead;
+			towers.topHead = current->next;
 			delete current;
 			current = nullptr;
 		}
-		topHead = topHeadDown;
+		towers.topHead = topHeadDown;
 		if(topHeadDown) topHeadDown = topHeadDown->down;
 	}
 }
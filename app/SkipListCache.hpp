@@ -0,0 +1,325 @@
+#ifndef ___SKIP_LIST_CACHE_HPP
+#define ___SKIP_LIST_CACHE_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "SkipList.hpp"
+#include "runtimeexcept.hpp"
+
+// How many bytes does a key or value own on the heap, beyond its own
+// sizeof? SkipListCache charges these against its budget. Specialize it
+// for types that allocate; the default assumes they do not.
+template<typename T>
+class HeapBytes
+{
+public:
+	size_t operator()(const T &) const { return 0; }
+};
+
+template<>
+class HeapBytes<std::string>
+{
+public:
+	size_t operator()(const std::string & s) const
+	{
+		// Short strings live inside the object itself.
+		return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+	}
+};
+
+template<typename T>
+class HeapBytes<std::vector<T>>
+{
+public:
+	size_t operator()(const std::vector<T> & v) const { return v.capacity() * sizeof(T); }
+};
+
+
+// An ordered cache on top of a SkipList, held under a byte budget.
+//
+// The budget covers everything SkipList::memoryUsage() reports (every
+// tower node, the sentinels and the hash index) plus the HeapBytes of
+// every value and of every key once per lane its tower reaches, since
+// each tower node stores its own copy of the key. Whenever an insert
+// leaves the cache over budget, entries are evicted by CLOCK: a hand
+// walks the bottom lane, clearing the reference bit that each lookup
+// sets and evicting the first entry whose bit is already clear.
+//
+// Entries may carry a time to live. An expired entry is removed when a
+// lookup runs into it, and a sweeper walks a bounded slice of the bottom
+// lane on every put to reclaim the ones nobody asks for. Expired entries
+// are never visited or returned, swept yet or not.
+//
+// *Clock* is any std::chrono clock; tests substitute one they control.
+template<typename Key, typename Value, typename Clock = std::chrono::steady_clock>
+class SkipListCache
+{
+
+private:
+
+	class Entry
+	{
+
+	public:
+
+		Value value;
+		typename Clock::time_point expires;
+		size_t heapBytes;
+		// Set by lookups, cleared by the passing CLOCK hand.
+		mutable bool referenced;
+
+		Entry(const Value & value = Value(), typename Clock::time_point expires = Clock::time_point::max(), size_t heapBytes = 0):
+		value(value),
+		expires(expires),
+		heapBytes(heapBytes),
+		referenced(false)
+		{
+
+		}
+
+	};
+
+	typedef typename SkipList<Key, Entry>::Cursor Cursor;
+
+	SkipList<Key, Entry> list;
+	size_t budget;
+	size_t heapBytes;
+	size_t sweepSlice;
+	Cursor hand;
+	Cursor sweeper;
+
+public:
+
+	// *byteBudget* bounds memoryUsage() after every put. *sweepSlice* is how
+	// many entries the sweeper inspects per put; zero leaves expired entries
+	// to lookups, eviction and explicit sweep() calls.
+	SkipListCache(size_t byteBudget, size_t sweepSlice = 4);
+
+	// How many entries are stored, counting expired ones not yet reclaimed?
+	size_t size() const noexcept;
+
+	bool isEmpty() const noexcept;
+
+	// Bytes charged against the budget.
+	size_t memoryUsage() const;
+
+	size_t byteBudget() const noexcept;
+
+	// Change the budget, evicting at once if the cache is now over it.
+	void setByteBudget(size_t byteBudget);
+
+	// Insert or replace the value for this key. A *ttl* of zero never expires.
+	// Return true if the key was not in the cache (or had expired).
+	// May evict other entries, or this one if it alone exceeds the budget.
+	bool put(const Key & k, const Value & v, typename Clock::duration ttl = Clock::duration::zero());
+
+	// Return the value associated with the given key and mark it as used.
+	// Throw a RuntimeException if the key is absent or has expired.
+	const Value & find(const Key & k);
+
+	bool contains(const Key & k);
+
+	// Remove this key. Return false if it was not in the cache.
+	bool erase(const Key & k);
+
+	// Call visit(key, value) for every live key in [lo, hi], in increasing order.
+	// Range scans do not count as uses for eviction.
+	template<typename Visitor>
+	void forEachInRange(const Key & lo, const Key & hi, Visitor visit) const;
+
+	// Inspect up to *maxEntries* entries from where the last sweep stopped,
+	// wrapping around at the end, and remove the expired ones.
+	// Return how many were removed.
+	size_t sweep(size_t maxEntries);
+
+private:
+
+	bool expired(const Entry & e, typename Clock::time_point now) const;
+
+	// Look the key up, reclaiming it if it has expired.
+	Entry* live(const Key & k);
+
+	// *k* must not refer to a key stored in the list.
+	void removeEntry(const Key & k);
+
+	void evictOverBudget();
+};
+
+template<typename Key, typename Value, typename Clock>
+SkipListCache<Key, Value, Clock>::SkipListCache(size_t byteBudget, size_t sweepSlice):
+	budget(byteBudget),
+	heapBytes(0),
+	sweepSlice(sweepSlice),
+	hand(list.cursor()),
+	sweeper(list.cursor())
+{
+	// Indexing gives the list its towers up front, so the hand and the
+	// sweeper survive inserts and removals of other keys.
+	list.enableHashIndex();
+	hand = list.cursor();
+	sweeper = list.cursor();
+}
+
+template<typename Key, typename Value, typename Clock>
+size_t SkipListCache<Key, Value, Clock>::size() const noexcept
+{
+	return list.size();
+}
+
+template<typename Key, typename Value, typename Clock>
+bool SkipListCache<Key, Value, Clock>::isEmpty() const noexcept
+{
+	return list.isEmpty();
+}
+
+template<typename Key, typename Value, typename Clock>
+size_t SkipListCache<Key, Value, Clock>::memoryUsage() const
+{
+	return list.memoryUsage() + heapBytes;
+}
+
+template<typename Key, typename Value, typename Clock>
+size_t SkipListCache<Key, Value, Clock>::byteBudget() const noexcept
+{
+	return budget;
+}
+
+template<typename Key, typename Value, typename Clock>
+void SkipListCache<Key, Value, Clock>::setByteBudget(size_t byteBudget)
+{
+	budget = byteBudget;
+	evictOverBudget();
+}
+
+template<typename Key, typename Value, typename Clock>
+bool SkipListCache<Key, Value, Clock>::put(const Key & k, const Value & v, typename Clock::duration ttl)
+{
+	typename Clock::time_point expires = ttl == Clock::duration::zero() ? Clock::time_point::max() : Clock::now() + ttl;
+	Entry* e = live(k);
+	bool fresh = e == nullptr;
+	if(e)
+	{
+		heapBytes -= e->heapBytes;
+		e->value = v;
+		e->expires = expires;
+	}
+	else
+	{
+		list.insert(k, Entry(v, expires));
+		e = &list.find(k);
+	}
+	// Every node of the key's tower holds its own copy of the key.
+	e->heapBytes = HeapBytes<Key>()(k) * list.height(k) + HeapBytes<Value>()(v);
+	heapBytes += e->heapBytes;
+	sweep(sweepSlice);
+	evictOverBudget();
+	return fresh;
+}
+
+template<typename Key, typename Value, typename Clock>
+const Value & SkipListCache<Key, Value, Clock>::find(const Key & k)
+{
+	Entry* e = live(k);
+	if(!e) throw RuntimeException("key is not in the cache");
+	e->referenced = true;
+	return e->value;
+}
+
+template<typename Key, typename Value, typename Clock>
+bool SkipListCache<Key, Value, Clock>::contains(const Key & k)
+{
+	return live(k) != nullptr;
+}
+
+template<typename Key, typename Value, typename Clock>
+bool SkipListCache<Key, Value, Clock>::erase(const Key & k)
+{
+	if(!list.contains(k)) return false;
+	removeEntry(k);
+	return true;
+}
+
+template<typename Key, typename Value, typename Clock>
+template<typename Visitor>
+void SkipListCache<Key, Value, Clock>::forEachInRange(const Key & lo, const Key & hi, Visitor visit) const
+{
+	typename Clock::time_point now = Clock::now();
+	list.forEachInRange(lo, hi, [this, now, &visit](const Key & k, const Entry & e)
+	{
+		if(!expired(e, now)) visit(k, e.value);
+	});
+}
+
+template<typename Key, typename Value, typename Clock>
+size_t SkipListCache<Key, Value, Clock>::sweep(size_t maxEntries)
+{
+	typename Clock::time_point now = Clock::now();
+	size_t removed = 0;
+	for(size_t i = 0; i < maxEntries && !list.isEmpty(); ++i)
+	{
+		if(sweeper.atEnd()) sweeper = list.cursor();
+		if(expired(sweeper.value(), now))
+		{
+			Key k = sweeper.key();
+			removeEntry(k);
+			++removed;
+		}
+		else
+		{
+			sweeper.next();
+		}
+	}
+	return removed;
+}
+
+template<typename Key, typename Value, typename Clock>
+bool SkipListCache<Key, Value, Clock>::expired(const Entry & e, typename Clock::time_point now) const
+{
+	return e.expires <= now;
+}
+
+template<typename Key, typename Value, typename Clock>
+typename SkipListCache<Key, Value, Clock>::Entry* SkipListCache<Key, Value, Clock>::live(const Key & k)
+{
+	if(!list.contains(k)) return nullptr;
+	Entry & e = list.find(k);
+	if(!expired(e, Clock::now())) return &e;
+	removeEntry(k);
+	return nullptr;
+}
+
+template<typename Key, typename Value, typename Clock>
+void SkipListCache<Key, Value, Clock>::removeEntry(const Key & k)
+{
+	heapBytes -= list.find(k).heapBytes;
+	// Step the hand and the sweeper off the entry before it goes.
+	if(!hand.atEnd() && hand.key() == k) hand.next();
+	if(!sweeper.atEnd() && sweeper.key() == k) sweeper.next();
+	list.remove(k);
+}
+
+template<typename Key, typename Value, typename Clock>
+void SkipListCache<Key, Value, Clock>::evictOverBudget()
+{
+	typename Clock::time_point now = Clock::now();
+	while(memoryUsage() > budget && !list.isEmpty())
+	{
+		if(hand.atEnd()) hand = list.cursor();
+		const Entry & e = hand.value();
+		if(e.referenced && !expired(e, now))
+		{
+			// A second chance: evict it next time round unless it is used again.
+			e.referenced = false;
+			hand.next();
+		}
+		else
+		{
+			Key k = hand.key();
+			removeEntry(k);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef ___SKIP_LIST_SET_OPS_HPP
+#define ___SKIP_LIST_SET_OPS_HPP
+
+#include <vector>
+
+#include "SkipList.hpp"
+
+// Set algebra over the keys of SkipLists, e.g. posting lists of an inverted
+// index. Every operation walks the bottom lanes with SkipList::Cursor and
+// emits its result in increasing key order, either to a sink called as
+// sink(key, value) or straight into an (empty) output SkipList.
+//
+// Intersections and differences skip through the other list with
+// Cursor::seek, which gallops up its towers, so when one list is much
+// smaller the cost is about |smaller| * log(gap) rather than |a| + |b|.
+// Where both lists hold a key, the value is taken from the first list.
+
+
+// Keys present in both *a* and *b*.
+template<typename Key, typename Value, typename AggregateA, typename AggregateB, typename Sink>
+void intersect(const SkipList<Key, Value, AggregateA> & a, const SkipList<Key, Value, AggregateB> & b, Sink sink)
+{
+	typename SkipList<Key, Value, AggregateA>::Cursor ca = a.cursor();
+	typename SkipList<Key, Value, AggregateB>::Cursor cb = b.cursor();
+	while(!ca.atEnd() && !cb.atEnd())
+	{
+		if(ca.key() < cb.key())
+		{
+			ca.seek(cb.key());
+		}
+		else if(cb.key() < ca.key())
+		{
+			cb.seek(ca.key());
+		}
+		else
+		{
+			sink(ca.key(), ca.value());
+			ca.next();
+			cb.next();
+		}
+	}
+}
+
+// Keys present in *a*, *b*, or both.
+template<typename Key, typename Value, typename AggregateA, typename AggregateB, typename Sink>
+void unite(const SkipList<Key, Value, AggregateA> & a, const SkipList<Key, Value, AggregateB> & b, Sink sink)
+{
+	typename SkipList<Key, Value, AggregateA>::Cursor ca = a.cursor();
+	typename SkipList<Key, Value, AggregateB>::Cursor cb = b.cursor();
+	while(!ca.atEnd() || !cb.atEnd())
+	{
+		if(cb.atEnd() || (!ca.atEnd() && ca.key() < cb.key()))
+		{
+			sink(ca.key(), ca.value());
+			ca.next();
+		}
+		else if(ca.atEnd() || cb.key() < ca.key())
+		{
+			sink(cb.key(), cb.value());
+			cb.next();
+		}
+		else
+		{
+			sink(ca.key(), ca.value());
+			ca.next();
+			cb.next();
+		}
+	}
+}
+
+// Keys present in *a* but not in *b*.
+template<typename Key, typename Value, typename AggregateA, typename AggregateB, typename Sink>
+void difference(const SkipList<Key, Value, AggregateA> & a, const SkipList<Key, Value, AggregateB> & b, Sink sink)
+{
+	typename SkipList<Key, Value, AggregateA>::Cursor ca = a.cursor();
+	typename SkipList<Key, Value, AggregateB>::Cursor cb = b.cursor();
+	for(; !ca.atEnd(); ca.next())
+	{
+		cb.seek(ca.key());
+		if(cb.atEnd() || ca.key() < cb.key())
+		{
+			sink(ca.key(), ca.value());
+		}
+	}
+}
+
+// Keys present in every list of *lists* (a leapfrog join): each cursor in
+// turn seeks to the largest key seen so far until all of them agree.
+// An empty *lists* yields nothing.
+template<typename Key, typename Value, typename Aggregate, typename Sink>
+void intersectAll(const std::vector<const SkipList<Key, Value, Aggregate>*> & lists, Sink sink)
+{
+	if(lists.empty()) return;
+	std::vector<typename SkipList<Key, Value, Aggregate>::Cursor> cursors;
+	for(const SkipList<Key, Value, Aggregate>* list : lists)
+	{
+		cursors.push_back(list->cursor());
+		if(cursors.back().atEnd()) return;
+	}
+	size_t agreeing = 1;
+	size_t i = 1 % cursors.size();
+	while(true)
+	{
+		if(agreeing == cursors.size())
+		{
+			sink(cursors[0].key(), cursors[0].value());
+			cursors[0].next();
+			if(cursors[0].atEnd()) return;
+			agreeing = 1;
+			i = 1 % cursors.size();
+			continue;
+		}
+		const Key & target = cursors[(i + cursors.size() - 1) % cursors.size()].key();
+		cursors[i].seek(target);
+		if(cursors[i].atEnd()) return;
+		agreeing = cursors[i].key() < target || target < cursors[i].key() ? 1 : agreeing + 1;
+		i = (i + 1) % cursors.size();
+	}
+}
+
+
+// The same operations, filling an empty *out* list instead of a sink.
+
+template<typename Key, typename Value, typename AggregateA, typename AggregateB, typename AggregateOut>
+void intersect(const SkipList<Key, Value, AggregateA> & a, const SkipList<Key, Value, AggregateB> & b, SkipList<Key, Value, AggregateOut> & out)
+{
+	intersect(a, b, [&out](const Key & k, const Value & v) { out.insert(k, v); });
+}
+
+template<typename Key, typename Value, typename AggregateA, typename AggregateB, typename AggregateOut>
+void unite(const SkipList<Key, Value, AggregateA> & a, const SkipList<Key, Value, AggregateB> & b, SkipList<Key, Value, AggregateOut> & out)
+{
+	unite(a, b, [&out](const Key & k, const Value & v) { out.insert(k, v); });
+}
+
+template<typename Key, typename Value, typename AggregateA, typename AggregateB, typename AggregateOut>
+void difference(const SkipList<Key, Value, AggregateA> & a, const SkipList<Key, Value, AggregateB> & b, SkipList<Key, Value, AggregateOut> & out)
+{
+	difference(a, b, [&out](const Key & k, const Value & v) { out.insert(k, v); });
+}
+
+template<typename Key, typename Value, typename Aggregate, typename AggregateOut>
+void intersectAll(const std::vector<const SkipList<Key, Value, Aggregate>*> & lists, SkipList<Key, Value, AggregateOut> & out)
+{
+	intersectAll(lists, [&out](const Key & k, const Value & v) { out.insert(k, v); });
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include <random>
+#include <utility>
+#include <vector>
+#include "Benchmarks.hpp"
+#include "SkipList.hpp"
+
+
+namespace{
+
+	const unsigned BASE_SIZE = 200000;
+	const unsigned BATCH_SIZES[] = {10000, 100000};
+
+	// Odd keys on top of a list of even ones, as a sorted batch.
+	std::vector<std::pair<unsigned, unsigned>> sortedBatch(unsigned count, unsigned seed)
+	{
+		std::mt19937 gen(seed);
+		std::uniform_int_distribution<unsigned> step(1, 2 * BASE_SIZE / count);
+		std::vector<std::pair<unsigned, unsigned>> batch;
+		unsigned k = 1;
+		for(unsigned i = 0; i < count; ++i, k += 2 * step(gen))
+		{
+			batch.emplace_back(k, i);
+		}
+		return batch;
+	}
+
+	void fillBase(SkipList<unsigned, unsigned> & sl)
+	{
+		std::vector<std::pair<unsigned, unsigned>> base;
+		for(unsigned i = 0; i < BASE_SIZE; ++i)
+		{
+			base.emplace_back(i * 2, i);
+		}
+		sl.insertSortedBatch(base.begin(), base.end());
+	}
+
+}
+
+
+void runBatchInsertBench()
+{
+	std::cout << "Sorted batch insert (into " << BASE_SIZE << " keys)\n";
+	for(unsigned count : BATCH_SIZES)
+	{
+		std::vector<std::pair<unsigned, unsigned>> batch = sortedBatch(count, count);
+		{
+			SkipList<unsigned, unsigned> sl;
+			fillBase(sl);
+			BenchTimer t;
+			for(const std::pair<unsigned, unsigned> & kv : batch) sl.insert(kv.first, kv.second);
+			reportBench("insert x " + std::to_string(count), t.elapsedMs(), count);
+		}
+		{
+			SkipList<unsigned, unsigned> sl;
+			fillBase(sl);
+			BenchTimer t;
+			sl.insertSortedBatch(batch.begin(), batch.end());
+			reportBench("insertSortedBatch of " + std::to_string(count), t.elapsedMs(), count);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#ifndef ___BENCHMARKS_HPP
+#define ___BENCHMARKS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <iostream>
+#include <vector>
+
+// Each benchmark lives in its own source file in the "bench" directory
+// and is launched from benchmain.cpp.
+
+class BenchTimer
+{
+	
+private:
+	
+	std::chrono::steady_clock::time_point start;
+	
+public:
+	
+	BenchTimer():
+	start(std::chrono::steady_clock::now())
+	{
+		
+	}
+	
+	double elapsedMs() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	
+};
+
+inline void reportBench(const std::string & name, double ms, size_t ops)
+{
+	std::cout << "  " << name << ": " << ms << " ms";
+	if(ops) std::cout << " (" << (ms * 1e6 / ops) << " ns/op)";
+	std::cout << '\n';
+}
+
+// Draws ranks in [0, n) with P(rank) proportional to 1 / (rank + 1)^s
+// by binary search over a precomputed CDF.
+class ZipfianGenerator
+{
+
+private:
+
+	std::vector<double> cdf;
+
+public:
+
+	ZipfianGenerator(unsigned n, double s):
+	cdf(n)
+	{
+		double sum = 0;
+		for(unsigned i = 0; i < n; ++i)
+		{
+			sum += 1.0 / std::pow(i + 1.0, s);
+			cdf[i] = sum;
+		}
+		for(double & c : cdf) c /= sum;
+	}
+
+	unsigned operator()(std::mt19937 & gen) const
+	{
+		double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+		return std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+	}
+
+};
+
+void runPriorityQueueBench();
+
+void runShardedBench();
+
+void runSetOpsBench();
+
+void runHashIndexBench();
+
+void runBatchInsertBench();
+
+void runCacheBench();
+
+void runSmallListBench();
+
+#endif
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include "Benchmarks.hpp"
+#include "SkipListCache.hpp"
+
+
+namespace{
+
+	const unsigned KEY_SPACE = 1 << 18;
+	const unsigned OPS = 500000;
+	const double ZIPF_EXPONENT = 0.99;
+	const size_t BUDGETS[] = {1 << 20, 4 << 20, 16 << 20};
+
+	// Read-through use: look a key up and put a freshly "loaded" value
+	// with a one second TTL on a miss. Values are 64-byte strings, so the
+	// heap bytes are charged as well as the nodes.
+	void readThrough(size_t budget, const ZipfianGenerator & zipf)
+	{
+		std::mt19937 gen(1);
+		SkipListCache<unsigned, std::string> cache(budget);
+		std::string loaded(64, 'v');
+		size_t hits = 0;
+		size_t peak = 0;
+		BenchTimer t;
+		for(unsigned i = 0; i < OPS; ++i)
+		{
+			// Scatter the hot ranks over the key space.
+			unsigned k = zipf(gen) * 2654435761u;
+			if(cache.contains(k))
+			{
+				hits += cache.find(k).size() == loaded.size();
+			}
+			else
+			{
+				cache.put(k, loaded, std::chrono::seconds(1));
+			}
+			peak = std::max(peak, cache.memoryUsage());
+		}
+		double ms = t.elapsedMs();
+		std::cout << "  budget " << (budget >> 10) << " KiB: peak " << (peak >> 10) << " KiB, "
+			<< cache.size() << " entries, hit rate " << 100.0 * hits / OPS << "%\n";
+		reportBench("  lookup or put", ms, OPS);
+	}
+
+}
+
+
+void runCacheBench()
+{
+	std::cout << "Ordered cache (Zipfian s=" << ZIPF_EXPONENT << ", " << KEY_SPACE << " keys)\n";
+	ZipfianGenerator zipf(KEY_SPACE, ZIPF_EXPONENT);
+	for(size_t budget : BUDGETS)
+	{
+		readThrough(budget, zipf);
+	}
+}
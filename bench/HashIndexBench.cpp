@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "Benchmarks.hpp"
+#include "SkipList.hpp"
+
+
+namespace{
+
+	const unsigned LIST_SIZES[] = {1000, 100000};
+	const unsigned LOOKUPS = 200000;
+
+	// Time hits and misses against the same keys with and without the
+	// hash index, and report what the index costs in memory.
+	void lookups(unsigned n, bool indexed)
+	{
+		std::mt19937 gen(n);
+		std::vector<unsigned> keys(n);
+		for(unsigned i = 0; i < n; ++i)
+		{
+			keys[i] = i * 2;
+		}
+		std::shuffle(keys.begin(), keys.end(), gen);
+		SkipList<unsigned, unsigned> sl;
+		sl.enableHashIndex(indexed);
+		for(unsigned k : keys) sl.insert(k, k);
+		std::uniform_int_distribution<unsigned> pick(0, n - 1);
+		std::vector<unsigned> probes(LOOKUPS);
+		for(unsigned & p : probes) p = keys[pick(gen)];
+		const char* label = indexed ? "hashed" : "plain ";
+		std::cout << "  " << label << " n=" << n << ": " << sl.memoryUsage() / double(n) << " bytes/key\n";
+		unsigned long long checksum = 0;
+		BenchTimer hits;
+		for(unsigned p : probes) checksum += sl.find(p);
+		reportBench(std::string(label) + " find", hits.elapsedMs(), LOOKUPS);
+		BenchTimer misses;
+		for(unsigned p : probes) checksum += sl.contains(p + 1);
+		reportBench(std::string(label) + " contains (miss)", misses.elapsedMs(), LOOKUPS);
+		BenchTimer neighbours;
+		for(unsigned p : probes) checksum += sl.isLargestKey(p) ? 0 : sl.nextKey(p);
+		reportBench(std::string(label) + " nextKey", neighbours.elapsedMs(), LOOKUPS);
+		if(checksum == 1) std::cout << "  (unlikely checksum)\n";
+	}
+
+}
+
+
+void runHashIndexBench()
+{
+	std::cout << "Hash index (" << LOOKUPS << " lookups)\n";
+	for(unsigned n : LIST_SIZES)
+	{
+		lookups(n, false);
+		lookups(n, true);
+	}
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+#include "Benchmarks.hpp"
+#include "SkipList.hpp"
+
+
+// Pops and drains unlink from the ends of the bottom lane and keep pace
+// with std::priority_queue. Inserts cannot: each one is an O(log n)
+// descent chasing pointers through scattered nodes, where a heap push
+// sifts through one contiguous array, so expect a skip list push to cost
+// several times a heap push at this size.
+
+namespace{
+
+	const unsigned QUEUE_SIZE = 100000;
+	const unsigned TIMER_ROUNDS = 200000;
+
+	std::vector<unsigned> distinctKeys(unsigned count, unsigned seed)
+	{
+		std::vector<unsigned> keys(count);
+		for(unsigned i = 0; i < count; ++i)
+		{
+			keys[i] = i * 2 + 1;
+		}
+		std::shuffle(keys.begin(), keys.end(), std::mt19937(seed));
+		return keys;
+	}
+
+	// Fill the queue, then empty it in order.
+	void fillAndDrain(const std::vector<unsigned> & keys)
+	{
+		unsigned long long checksum = 0;
+		{
+			SkipList<unsigned, unsigned> sl;
+			BenchTimer fill;
+			for(unsigned k : keys) sl.insert(k, k);
+			reportBench("SkipList insert", fill.elapsedMs(), keys.size());
+			BenchTimer drain;
+			while(!sl.isEmpty()) checksum += sl.popMin().first;
+			reportBench("SkipList popMin", drain.elapsedMs(), keys.size());
+		}
+		{
+			std::priority_queue<std::pair<unsigned, unsigned>, std::vector<std::pair<unsigned, unsigned>>, std::greater<std::pair<unsigned, unsigned>>> pq;
+			BenchTimer fill;
+			for(unsigned k : keys) pq.emplace(k, k);
+			reportBench("priority_queue push", fill.elapsedMs(), keys.size());
+			BenchTimer drain;
+			while(!pq.empty())
+			{
+				checksum -= pq.top().first;
+				pq.pop();
+			}
+			reportBench("priority_queue pop", drain.elapsedMs(), keys.size());
+		}
+		if(checksum != 0) std::cout << "  checksum mismatch\n";
+	}
+
+	// Timer-wheel pattern: a steady-state queue where each round schedules
+	// one new deadline and fires the earliest one.
+	void timerWheel(const std::vector<unsigned> & keys)
+	{
+		std::mt19937 gen(7);
+		std::uniform_int_distribution<unsigned> delay(1, QUEUE_SIZE);
+		{
+			SkipList<unsigned, unsigned> sl;
+			for(unsigned i = 0; i < QUEUE_SIZE / 2; ++i) sl.insert(keys[i], i);
+			unsigned now = 0;
+			BenchTimer t;
+			for(unsigned i = 0; i < TIMER_ROUNDS; ++i)
+			{
+				now = sl.popMin().first;
+				while(!sl.insert(now + delay(gen), i)) {}
+			}
+			reportBench("SkipList pop+insert", t.elapsedMs(), TIMER_ROUNDS);
+		}
+		gen.seed(7);
+		{
+			std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>> pq;
+			for(unsigned i = 0; i < QUEUE_SIZE / 2; ++i) pq.push(keys[i]);
+			unsigned now = 0;
+			BenchTimer t;
+			for(unsigned i = 0; i < TIMER_ROUNDS; ++i)
+			{
+				now = pq.top();
+				pq.pop();
+				pq.push(now + delay(gen));
+			}
+			reportBench("priority_queue pop+push", t.elapsedMs(), TIMER_ROUNDS);
+		}
+	}
+
+	// Batched expiry: drain everything due by a deadline in one call.
+	void batchedDrain(const std::vector<unsigned> & keys)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned k : keys) sl.insert(k, k);
+		std::vector<std::pair<unsigned, unsigned>> out;
+		out.reserve(keys.size());
+		BenchTimer t;
+		for(unsigned deadline = 1000; !sl.isEmpty(); deadline += 1000)
+		{
+			sl.drainUntil(deadline, out);
+		}
+		reportBench("SkipList drainUntil", t.elapsedMs(), keys.size());
+	}
+
+}
+
+
+void runPriorityQueueBench()
+{
+	std::cout << "Priority queue (" << QUEUE_SIZE << " keys)\n";
+	std::vector<unsigned> keys = distinctKeys(QUEUE_SIZE, 42);
+	fillAndDrain(keys);
+	timerWheel(keys);
+	batchedDrain(keys);
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include "Benchmarks.hpp"
+#include "SkipList.hpp"
+#include "SkipListSetOps.hpp"
+
+
+namespace{
+
+	const unsigned LARGE_SIZE = 200000;
+	const unsigned ROUNDS = 20;
+
+	// Compares galloping intersect() with dumping both lists through
+	// allKeysInOrder() and merging the vectors, for shrinking small lists.
+	void intersectBench(const SkipList<unsigned, unsigned> & large, unsigned smallSize)
+	{
+		SkipList<unsigned, unsigned> small;
+		unsigned stride = LARGE_SIZE * 2 / smallSize;
+		for(unsigned i = 0; i < smallSize; ++i)
+		{
+			small.insert(i * stride + (i % 2), i);
+		}
+		size_t matches = 0;
+		BenchTimer gallop;
+		for(unsigned r = 0; r < ROUNDS; ++r)
+		{
+			intersect(small, large, [&matches](const unsigned &, const unsigned &) { ++matches; });
+		}
+		double gallopMs = gallop.elapsedMs();
+		BenchTimer merge;
+		for(unsigned r = 0; r < ROUNDS; ++r)
+		{
+			std::vector<unsigned> a = small.allKeysInOrder();
+			std::vector<unsigned> b = large.allKeysInOrder();
+			std::vector<unsigned> out;
+			std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+			matches -= out.size();
+		}
+		double mergeMs = merge.elapsedMs();
+		std::cout << " " << smallSize << " x " << LARGE_SIZE << (matches ? " (mismatch)" : "") << '\n';
+		reportBench("intersect", gallopMs / ROUNDS, 0);
+		reportBench("allKeysInOrder + merge", mergeMs / ROUNDS, 0);
+	}
+
+}
+
+
+void runSetOpsBench()
+{
+	std::cout << "Set intersection\n";
+	SkipList<unsigned, unsigned> large;
+	for(unsigned i = 0; i < LARGE_SIZE; ++i)
+	{
+		large.insert(i * 2, i);
+	}
+	large.rebalance();
+	for(unsigned smallSize = 100000; smallSize >= 10; smallSize /= 10)
+	{
+		intersectBench(large, smallSize);
+	}
+}
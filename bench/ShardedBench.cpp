@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Benchmarks.hpp"
+#include "SkipList.hpp"
+#include "ShardedSkipList.hpp"
+
+
+namespace{
+
+	const unsigned KEY_SPACE = 1 << 20;
+	const unsigned PRELOAD = 100000;
+	const unsigned OPS_PER_THREAD = 100000;
+	const double ZIPF_EXPONENT = 0.99;
+
+	// Baseline: one SkipList behind one mutex.
+	class SingleMutexSkipList
+	{
+
+	private:
+
+		SkipList<unsigned, unsigned> list;
+		mutable std::mutex lock;
+
+	public:
+
+		bool insert(unsigned k, unsigned v)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return list.insert(k, v);
+		}
+
+		bool contains(unsigned k) const
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return list.contains(k);
+		}
+
+	};
+
+	// Each thread performs 80% lookups and 20% inserts on Zipfian keys.
+	// The key is the rank itself, so the hot keys sit together at the low
+	// end of the key space and most of the traffic lands on one shard.
+	template<typename List>
+	double runMixed(List & list, const ZipfianGenerator & zipf, unsigned threadCount)
+	{
+		BenchTimer t;
+		std::vector<std::thread> threads;
+		for(unsigned id = 0; id < threadCount; ++id)
+		{
+			threads.emplace_back([&list, &zipf, id]()
+			{
+				std::mt19937 gen(id + 1);
+				for(unsigned i = 0; i < OPS_PER_THREAD; ++i)
+				{
+					unsigned k = zipf(gen);
+					if(i % 5 == 0) list.insert(k, i);
+					else list.contains(k);
+				}
+			});
+		}
+		for(std::thread & thread : threads) thread.join();
+		return t.elapsedMs();
+	}
+
+}
+
+
+void runShardedBench()
+{
+	unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+	std::cout << "Sharded vs single mutex (Zipfian s=" << ZIPF_EXPONENT << ", "
+		<< std::thread::hardware_concurrency() << " hardware threads)\n";
+	ZipfianGenerator zipf(KEY_SPACE, ZIPF_EXPONENT);
+	for(unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		std::mt19937 gen(99);
+		SingleMutexSkipList single;
+		ShardedSkipList<unsigned, unsigned> sharded(8192);
+		for(unsigned i = 0; i < PRELOAD; ++i)
+		{
+			unsigned k = gen() % KEY_SPACE;
+			single.insert(k, i);
+			sharded.insert(k, i);
+		}
+		sharded.maintain();
+		size_t ops = static_cast<size_t>(threadCount) * OPS_PER_THREAD;
+		std::cout << " " << threadCount << " threads\n";
+		reportBench("single mutex", runMixed(single, zipf, threadCount), ops);
+		reportBench("sharded, by size (" + std::to_string(sharded.numShards()) + " shards)", runMixed(sharded, zipf, threadCount), ops);
+		// Let maintain() split the shards the skewed traffic makes hot.
+		for(unsigned round = 0; round < 3; ++round)
+		{
+			runMixed(sharded, zipf, threadCount);
+			sharded.maintain();
+		}
+		reportBench("sharded, hot shard split (" + std::to_string(sharded.numShards()) + " shards)", runMixed(sharded, zipf, threadCount), ops);
+	}
+}
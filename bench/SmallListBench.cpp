@@ -0,0 +1,122 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "Benchmarks.hpp"
+#include "SkipList.hpp"
+
+
+namespace{
+
+	const unsigned LIST_COUNT = 100000;
+	const unsigned KEYS_PER_LIST[] = {0, 2, 4, 12};
+
+	// The layout SkipList had before inline storage: this object, plus a
+	// head and a rear sentinel on every lane and one node per key per lane.
+	template<typename Key, typename Value>
+	class BaselineNode
+	{
+	public:
+		Key key;
+		Value val;
+		BaselineNode* next;
+		BaselineNode* prev;
+		BaselineNode* down;
+		BaselineNode* up;
+	};
+
+	class BaselineList
+	{
+	public:
+		void* topHead;
+		void* topRear;
+		void* btmHead;
+		void* btmRear;
+		unsigned layerCount;
+		unsigned nodeCount;
+		unsigned layerCapacity;
+		char itor;
+	};
+
+	unsigned makeKey(unsigned list, unsigned k, unsigned)
+	{
+		return k * 7 + list;
+	}
+
+	std::string makeKey(unsigned list, unsigned k, const std::string &)
+	{
+		return "session" + std::to_string(list) + "/" + std::to_string(k);
+	}
+
+	// Build many small lists, either left inline or pushed into towers
+	// (enabling and dropping the hash index promotes a list), then look
+	// every key up once.
+	template<typename Key, typename Value>
+	void smallLists(const std::string & types, unsigned keys, bool towers)
+	{
+		std::vector<std::unique_ptr<SkipList<Key, Value>>> lists;
+		lists.reserve(LIST_COUNT);
+		BenchTimer build;
+		for(unsigned i = 0; i < LIST_COUNT; ++i)
+		{
+			lists.emplace_back(new SkipList<Key, Value>());
+			if(towers)
+			{
+				lists.back()->enableHashIndex();
+				lists.back()->enableHashIndex(false);
+			}
+			for(unsigned k = 0; k < keys; ++k)
+			{
+				lists.back()->insert(makeKey(i, k, Key()), Value());
+			}
+		}
+		double buildMs = build.elapsedMs();
+		size_t bytes = 0;
+		size_t baselineBytes = 0;
+		size_t found = 0;
+		BenchTimer lookups;
+		for(unsigned i = 0; i < LIST_COUNT; ++i)
+		{
+			for(unsigned k = 0; k < keys; ++k)
+			{
+				found += lists[i]->contains(makeKey(i, k, Key()));
+			}
+		}
+		double lookupMs = lookups.elapsedMs();
+		for(unsigned i = 0; i < LIST_COUNT; ++i)
+		{
+			bytes += lists[i]->memoryUsage();
+			size_t nodes = 2 * lists[i]->numLayers();
+			for(unsigned k = 0; k < keys; ++k)
+			{
+				nodes += lists[i]->height(makeKey(i, k, Key()));
+			}
+			baselineBytes += sizeof(BaselineList) + nodes * sizeof(BaselineNode<Key, Value>);
+		}
+		const char* label = towers ? "towers" : "inline";
+		std::cout << "  " << types << ", " << label << ", " << keys << " keys: " << bytes / LIST_COUNT
+			<< " bytes/list (baseline layout " << baselineBytes / LIST_COUNT << ")\n";
+		reportBench(std::string(label) + " build", buildMs, LIST_COUNT);
+		if(keys) reportBench(std::string(label) + " find", lookupMs, size_t(LIST_COUNT) * keys);
+		if(found != size_t(LIST_COUNT) * keys) std::cout << "  (lookups missed)\n";
+	}
+
+	template<typename Key, typename Value>
+	void smallListsOf(const std::string & types)
+	{
+		std::cout << " " << types << ": sizeof(SkipList) = " << sizeof(SkipList<Key, Value>) << "\n";
+		for(unsigned keys : KEYS_PER_LIST)
+		{
+			smallLists<Key, Value>(types, keys, false);
+			smallLists<Key, Value>(types, keys, true);
+		}
+	}
+
+}
+
+
+void runSmallListBench()
+{
+	std::cout << "Small lists (" << LIST_COUNT << " lists)\n";
+	smallListsOf<unsigned, unsigned>("<unsigned, unsigned>");
+	smallListsOf<std::string, std::string>("<string, string>");
+}
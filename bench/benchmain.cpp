@@ -0,0 +1,18 @@
+// benchmain.cpp
+//
+// Runs every benchmark declared in Benchmarks.hpp, in order.
+
+#include "Benchmarks.hpp"
+
+
+int main()
+{
+    runPriorityQueueBench();
+    runShardedBench();
+    runSetOpsBench();
+    runHashIndexBench();
+    runBatchInsertBench();
+    runCacheBench();
+    runSmallListBench();
+    return 0;
+}
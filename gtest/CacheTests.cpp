@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#include "SkipListCache.hpp"
+
+
+namespace{
+
+	// A clock the tests move by hand.
+	class ManualClock
+	{
+	public:
+		typedef std::chrono::milliseconds duration;
+		typedef duration::rep rep;
+		typedef duration::period period;
+		typedef std::chrono::time_point<ManualClock> time_point;
+		static const bool is_steady = true;
+
+		static time_point current;
+
+		static time_point now() { return current; }
+		static void advance(duration d) { current += d; }
+	};
+
+	ManualClock::time_point ManualClock::current;
+
+	typedef SkipListCache<unsigned, unsigned, ManualClock> Cache;
+
+
+	TEST(CacheTests, PutFindAndErase)
+	{
+		Cache cache(1 << 20);
+		EXPECT_TRUE( cache.put(1, 10) );
+		EXPECT_TRUE( cache.put(2, 20) );
+		EXPECT_FALSE( cache.put(1, 11) );
+		EXPECT_EQ( 2, cache.size() );
+		EXPECT_EQ( 11, cache.find(1) );
+		EXPECT_THROW(cache.find(3), RuntimeException);
+		EXPECT_TRUE( cache.erase(1) );
+		EXPECT_FALSE( cache.erase(1) );
+		EXPECT_FALSE( cache.contains(1) );
+		EXPECT_EQ( 1, cache.size() );
+	}
+
+	TEST(CacheTests, StaysWithinBudget)
+	{
+		Cache probe(1 << 20);
+		size_t emptyBytes = probe.memoryUsage();
+		for(unsigned i = 0; i < 100; i++)
+		{
+			probe.put(i, i);
+		}
+		size_t budget = probe.memoryUsage();
+		Cache cache(budget);
+		for(unsigned i = 0; i < 5000; i++)
+		{
+			cache.put((i * 7919) % 10007, i);
+			EXPECT_LE( cache.memoryUsage(), budget );
+		}
+		EXPECT_GT( cache.size(), 50 );
+		cache.setByteBudget(emptyBytes);
+		EXPECT_TRUE( cache.isEmpty() );
+	}
+
+	TEST(CacheTests, ClockKeepsUsedEntries)
+	{
+		Cache probe(1 << 20);
+		for(unsigned i = 0; i < 64; i++)
+		{
+			probe.put(i, i);
+		}
+		Cache cache(probe.memoryUsage());
+		for(unsigned i = 0; i < 64; i++)
+		{
+			cache.put(i, i);
+		}
+		for(unsigned round = 0; round < 20; round++)
+		{
+			for(unsigned i = 0; i < 64; i += 8)
+			{
+				EXPECT_EQ( i, cache.find(i) );
+			}
+			cache.put(1000 + round, round);
+		}
+		for(unsigned i = 0; i < 64; i += 8)
+		{
+			EXPECT_TRUE( cache.contains(i) );
+		}
+	}
+
+	TEST(CacheTests, EntriesExpire)
+	{
+		Cache cache(1 << 20, 0);
+		cache.put(1, 1, std::chrono::milliseconds(100));
+		cache.put(2, 2, std::chrono::milliseconds(300));
+		cache.put(3, 3);
+		ManualClock::advance(std::chrono::milliseconds(200));
+		std::vector<unsigned> visited;
+		cache.forEachInRange(0, 10, [&visited](unsigned k, unsigned)
+		{
+			visited.push_back(k);
+		});
+		EXPECT_EQ( std::vector<unsigned>({2, 3}), visited );
+		// Still stored until something runs into it.
+		EXPECT_EQ( 3, cache.size() );
+		EXPECT_FALSE( cache.contains(1) );
+		EXPECT_EQ( 2, cache.size() );
+		EXPECT_TRUE( cache.put(1, 5) );
+		EXPECT_EQ( 5, cache.find(1) );
+		ManualClock::advance(std::chrono::milliseconds(200));
+		EXPECT_THROW(cache.find(2), RuntimeException);
+		EXPECT_EQ( 3, cache.find(3) );
+	}
+
+	TEST(CacheTests, SweeperReclaimsInSlices)
+	{
+		Cache cache(1 << 20, 0);
+		for(unsigned i = 0; i < 100; i++)
+		{
+			cache.put(i, i, std::chrono::milliseconds(i % 2 ? 50 : 0));
+		}
+		ManualClock::advance(std::chrono::milliseconds(60));
+		EXPECT_EQ( 10, cache.sweep(20) );
+		EXPECT_EQ( 90, cache.size() );
+		EXPECT_EQ( 40, cache.sweep(1000) );
+		EXPECT_EQ( 50, cache.size() );
+		EXPECT_EQ( 0, cache.sweep(1000) );
+		for(unsigned i = 0; i < 100; i += 2)
+		{
+			EXPECT_EQ( i, cache.find(i) );
+		}
+	}
+
+	TEST(CacheTests, CountsHeapBytes)
+	{
+		SkipListCache<std::string, std::string, ManualClock> cache(1 << 20);
+		cache.put("k", "short");
+		cache.erase("k");
+		size_t before = cache.memoryUsage();
+		cache.put("k", std::string(1000, 'x'));
+		EXPECT_GE( cache.memoryUsage() - before, 1000 );
+		cache.put("k", "short");
+		EXPECT_LT( cache.memoryUsage() - before, 1000 );
+		cache.erase("k");
+		EXPECT_EQ( before, cache.memoryUsage() );
+	}
+
+	TEST(CacheTests, ChargesKeyCopiesInEveryLane)
+	{
+		// Find a long key whose tower is at least three nodes tall.
+		SkipList<std::string, unsigned> probe;
+		std::string k;
+		for(char c = 'a'; probe.isEmpty() || probe.height(k) < 3; ++c)
+		{
+			k = std::string(1000, 'x') + c;
+			probe.insert(k, 0);
+		}
+		SkipListCache<std::string, unsigned, ManualClock> cache(1 << 20);
+		cache.put(k, 0);
+		cache.erase(k);
+		size_t before = cache.memoryUsage();
+		cache.put(k, 1);
+		EXPECT_GE( cache.memoryUsage() - before, 1000 * probe.height(k) );
+		cache.put(k, 2);
+		EXPECT_GE( cache.memoryUsage() - before, 1000 * probe.height(k) );
+		cache.erase(k);
+		EXPECT_EQ( before, cache.memoryUsage() );
+	}
+
+}
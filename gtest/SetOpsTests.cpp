@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "SkipListSetOps.hpp"
+
+
+namespace{
+
+
+	std::vector<unsigned> fill(SkipList<unsigned, unsigned> & sl, unsigned count, unsigned stride, unsigned offset)
+	{
+		std::vector<unsigned> keys;
+		for(unsigned i = 0; i < count; i++)
+		{
+			sl.insert(i * stride + offset, i);
+			keys.push_back(i * stride + offset);
+		}
+		return keys;
+	}
+
+	std::vector<unsigned> collect(void (*op)(const SkipList<unsigned, unsigned> &, const SkipList<unsigned, unsigned> &, SkipList<unsigned, unsigned> &),
+		const SkipList<unsigned, unsigned> & a, const SkipList<unsigned, unsigned> & b)
+	{
+		SkipList<unsigned, unsigned> out;
+		op(a, b, out);
+		return out.allKeysInOrder();
+	}
+
+	TEST(SetOpsTests, CursorSeek)
+	{
+		SkipList<unsigned, unsigned> sl;
+		fill(sl, 1000, 3, 0);
+		SkipList<unsigned, unsigned>::Cursor c = sl.cursor();
+		EXPECT_EQ( 0, c.key() );
+		c.seek(1);
+		EXPECT_EQ( 3, c.key() );
+		c.seek(2000);
+		EXPECT_EQ( 2001, c.key() );
+		EXPECT_EQ( 667, c.value() );
+		c.seek(5);
+		EXPECT_EQ( 2001, c.key() );
+		c.next();
+		EXPECT_EQ( 2004, c.key() );
+		c.seek(5000);
+		EXPECT_TRUE( c.atEnd() );
+		SkipList<unsigned, unsigned> empty;
+		EXPECT_TRUE( empty.cursor().atEnd() );
+	}
+
+	TEST(SetOpsTests, IntersectUniteDifference)
+	{
+		SkipList<unsigned, unsigned> a, b;
+		std::vector<unsigned> ka = fill(a, 500, 2, 0);
+		std::vector<unsigned> kb = fill(b, 300, 3, 1);
+		std::vector<unsigned> expected;
+		std::set_intersection(ka.begin(), ka.end(), kb.begin(), kb.end(), std::back_inserter(expected));
+		EXPECT_TRUE( expected == collect(intersect, a, b) );
+		EXPECT_TRUE( expected == collect(intersect, b, a) );
+		expected.clear();
+		std::set_union(ka.begin(), ka.end(), kb.begin(), kb.end(), std::back_inserter(expected));
+		EXPECT_TRUE( expected == collect(unite, a, b) );
+		expected.clear();
+		std::set_difference(ka.begin(), ka.end(), kb.begin(), kb.end(), std::back_inserter(expected));
+		EXPECT_TRUE( expected == collect(difference, a, b) );
+		expected.clear();
+		std::set_difference(kb.begin(), kb.end(), ka.begin(), ka.end(), std::back_inserter(expected));
+		EXPECT_TRUE( expected == collect(difference, b, a) );
+	}
+
+	TEST(SetOpsTests, ValuesComeFromFirstList)
+	{
+		SkipList<std::string, std::string> a, b;
+		a.insert("apple", "a");
+		a.insert("kiwi", "a");
+		b.insert("kiwi", "b");
+		b.insert("pear", "b");
+		std::vector<std::string> values;
+		unite(a, b, [&values](const std::string & k, const std::string & v)
+		{
+			values.push_back(k + ":" + v);
+		});
+		EXPECT_TRUE( values == std::vector<std::string>({"apple:a", "kiwi:a", "pear:b"}) );
+	}
+
+	TEST(SetOpsTests, SkewedSizes)
+	{
+		SkipList<unsigned, unsigned> small, large;
+		fill(large, 20000, 1, 0);
+		small.insert(5, 0);
+		small.insert(12345, 0);
+		small.insert(19999, 0);
+		small.insert(30000, 0);
+		EXPECT_TRUE( collect(intersect, small, large) == std::vector<unsigned>({5, 12345, 19999}) );
+		EXPECT_TRUE( collect(intersect, large, small) == std::vector<unsigned>({5, 12345, 19999}) );
+		EXPECT_TRUE( collect(difference, small, large) == std::vector<unsigned>({30000}) );
+		SkipList<unsigned, unsigned> empty;
+		EXPECT_TRUE( collect(intersect, empty, large).empty() );
+		EXPECT_EQ( 20000, collect(unite, empty, large).size() );
+	}
+
+	TEST(SetOpsTests, IntersectAll)
+	{
+		SkipList<unsigned, unsigned> by2, by3, by5;
+		fill(by2, 1000, 2, 0);
+		fill(by3, 1000, 3, 0);
+		fill(by5, 1000, 5, 0);
+		std::vector<const SkipList<unsigned, unsigned>*> lists = {&by2, &by3, &by5};
+		SkipList<unsigned, unsigned> out;
+		intersectAll(lists, out);
+		std::vector<unsigned> expected;
+		for(unsigned k = 0; k < 2000; k += 30)
+		{
+			expected.push_back(k);
+		}
+		EXPECT_TRUE( expected == out.allKeysInOrder() );
+		size_t count = 0;
+		lists = {&by3};
+		intersectAll(lists, [&count](const unsigned &, const unsigned &) { ++count; });
+		EXPECT_EQ( 1000, count );
+		SkipList<unsigned, unsigned> empty;
+		lists = {&by2, &empty};
+		intersectAll(lists, [&count](const unsigned &, const unsigned &) { ++count; });
+		EXPECT_EQ( 1000, count );
+	}
+
+}
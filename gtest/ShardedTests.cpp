@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ShardedSkipList.hpp"
+
+
+namespace{
+
+
+	TEST(ShardedTests, CreatedBasics)
+	{
+		ShardedSkipList<unsigned, unsigned> ssl(64, {100, 200});
+		EXPECT_EQ( 3, ssl.numShards() );
+		EXPECT_EQ( 0, ssl.size() );
+		EXPECT_TRUE( ssl.isEmpty() );
+	}
+
+	TEST(ShardedTests, UnsortedBoundariesThrow)
+	{
+		typedef ShardedSkipList<unsigned, unsigned> List;
+		EXPECT_THROW(List(64, {200, 100}), RuntimeException);
+		EXPECT_THROW(List(64, {100, 100}), RuntimeException);
+		EXPECT_NO_THROW(List(64, {100, 200}));
+	}
+
+	TEST(ShardedTests, InsertAndFindAcrossShards)
+	{
+		ShardedSkipList<unsigned, unsigned> ssl(64, {100, 200});
+		for(unsigned i = 0; i < 300; i++)
+		{
+			EXPECT_TRUE( ssl.insert(i, i * 3) );
+		}
+		EXPECT_FALSE( ssl.insert(150, 0) );
+		EXPECT_EQ( 300, ssl.size() );
+		for(unsigned i = 0; i < 300; i++)
+		{
+			EXPECT_EQ( i * 3, ssl.find(i) );
+		}
+		EXPECT_THROW(ssl.find(300), RuntimeException);
+		EXPECT_FALSE( ssl.contains(300) );
+		EXPECT_TRUE( ssl.contains(299) );
+	}
+
+	TEST(ShardedTests, OversizedShardsSplit)
+	{
+		ShardedSkipList<unsigned, unsigned> ssl(16);
+		std::vector<unsigned> expected;
+		for(unsigned i = 0; i < 1000; i++)
+		{
+			ssl.insert((i * 7919) % 1000, i);
+			expected.push_back(i);
+		}
+		EXPECT_GE( ssl.numShards(), 1000 / 16 );
+		EXPECT_TRUE( expected == ssl.allKeysInOrder() );
+	}
+
+	TEST(ShardedTests, ColdShardsMerge)
+	{
+		std::vector<std::string> boundaries;
+		for(char c = 'b'; c <= 'z'; ++c)
+		{
+			boundaries.push_back(std::string(1, c));
+		}
+		ShardedSkipList<std::string, int> ssl(64, boundaries);
+		ssl.insert("apple", 1);
+		ssl.insert("kiwi", 2);
+		ssl.insert("zucchini", 3);
+		EXPECT_EQ( 26, ssl.numShards() );
+		ssl.maintain();
+		EXPECT_EQ( 1, ssl.numShards() );
+		EXPECT_TRUE( ssl.allKeysInOrder() == std::vector<std::string>({"apple", "kiwi", "zucchini"}) );
+		EXPECT_EQ( 2, ssl.find("kiwi") );
+	}
+
+	TEST(ShardedTests, RangeAcrossShards)
+	{
+		ShardedSkipList<int, int> ssl(8);
+		for(int i = -100; i <= 100; i++)
+		{
+			ssl.insert(i, i);
+		}
+		std::vector<std::pair<int, int>> r = ssl.range(-20, 30);
+		EXPECT_EQ( 51, r.size() );
+		for(size_t i = 0; i < r.size(); i++)
+		{
+			EXPECT_EQ( -20 + static_cast<int>(i), r[i].first );
+		}
+		EXPECT_TRUE( ssl.range(200, 300).empty() );
+		EXPECT_TRUE( ssl.range(30, -20).empty() );
+	}
+
+	TEST(ShardedTests, ConcurrentInserts)
+	{
+		ShardedSkipList<unsigned, unsigned> ssl(32);
+		std::vector<std::thread> threads;
+		for(unsigned t = 0; t < 4; t++)
+		{
+			threads.emplace_back([&ssl, t]()
+			{
+				for(unsigned i = 0; i < 500; i++)
+				{
+					ssl.insert(i * 4 + t, t);
+					if(i % 100 == 0) ssl.maintain();
+				}
+			});
+		}
+		for(std::thread & thread : threads)
+		{
+			thread.join();
+		}
+		EXPECT_EQ( 2000, ssl.size() );
+		std::vector<unsigned> keys = ssl.allKeysInOrder();
+		for(unsigned i = 0; i < 2000; i++)
+		{
+			EXPECT_EQ( i, keys[i] );
+		}
+	}
+
+	TEST(ShardedTests, ReadersFollowSplitsAndMerges)
+	{
+		ShardedSkipList<unsigned, unsigned> ssl(16);
+		for(unsigned i = 0; i < 1000; i += 2)
+		{
+			ssl.insert(i, i);
+		}
+		std::atomic<bool> done(false);
+		std::atomic<unsigned> misses(0);
+		std::vector<std::thread> readers;
+		for(unsigned t = 0; t < 3; t++)
+		{
+			readers.emplace_back([&ssl, &done, &misses, t]()
+			{
+				for(unsigned i = t; !done.load(); i = (i + 7) % 1000)
+				{
+					// Even keys are there from the start and never move out of reach.
+					if(i % 2 == 0 && (!ssl.contains(i) || ssl.find(i) != i)) ++misses;
+				}
+			});
+		}
+		for(unsigned round = 0; round < 20; round++)
+		{
+			for(unsigned i = round * 50 + 1; i < round * 50 + 50; i += 2)
+			{
+				ssl.insert(i, i);
+			}
+			ssl.maintain();
+		}
+		done.store(true);
+		for(std::thread & thread : readers)
+		{
+			thread.join();
+		}
+		EXPECT_EQ( 0, misses.load() );
+		EXPECT_EQ( 1000, ssl.size() );
+		EXPECT_EQ( 1000, ssl.allKeysInOrder().size() );
+	}
+
+}
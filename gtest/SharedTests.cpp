@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "SharedSkipList.hpp"
+
+
+namespace{
+
+
+	// Segment names are global to the host, so keep them unique per run.
+	std::string segmentName(const std::string & test)
+	{
+		return "/skiplist-test-" + test + "-" + std::to_string(getpid());
+	}
+
+	TEST(SharedTests, CreatedBasics)
+	{
+		std::string name = segmentName("basics");
+		SharedSkipList<unsigned, unsigned> writer(name, 1 << 16);
+		SharedSkipList<unsigned, unsigned>::removeSegment(name);
+		EXPECT_EQ( 2, writer.numLayers() );
+		EXPECT_EQ( 0, writer.size() );
+		EXPECT_TRUE( writer.isEmpty() );
+		EXPECT_THROW(writer.find(1), RuntimeException);
+	}
+
+	TEST(SharedTests, ReaderSeesWriterInserts)
+	{
+		std::string name = segmentName("reader");
+		SharedSkipList<unsigned, unsigned> writer(name, 1 << 20);
+		SharedSkipList<unsigned, unsigned> reader(name);
+		SharedSkipList<unsigned, unsigned>::removeSegment(name);
+		std::vector<unsigned> expected;
+		for(unsigned i = 0; i < 500; i++)
+		{
+			EXPECT_TRUE( writer.insert(i, i + 100) );
+			expected.push_back(i);
+		}
+		EXPECT_FALSE( writer.insert(7, 0) );
+		EXPECT_EQ( 500, reader.size() );
+		for(unsigned i = 0; i < 500; i++)
+		{
+			EXPECT_EQ( i + 100, reader.find(i) );
+		}
+		EXPECT_FALSE( reader.contains(500) );
+		EXPECT_TRUE( expected == reader.allKeysInOrder() );
+		EXPECT_THROW(reader.insert(1000, 1000), RuntimeException);
+		std::vector<unsigned> values;
+		reader.forEachInRange(10, 14, [&values](const unsigned &, const unsigned & v)
+		{
+			values.push_back(v);
+		});
+		EXPECT_TRUE( values == std::vector<unsigned>({110, 111, 112, 113, 114}) );
+	}
+
+	TEST(SharedTests, HeightsMatchSkipList)
+	{
+		std::string name = segmentName("heights");
+		SharedSkipList<unsigned, unsigned> shared(name, 1 << 22);
+		SharedSkipList<unsigned, unsigned>::removeSegment(name);
+		SkipList<unsigned, unsigned> local;
+		for(unsigned i = 0; i < 16; i++)
+		{
+			shared.insert(i, i);
+			local.insert(i, i);
+		}
+		shared.insert(255, 255);
+		local.insert(255, 255);
+		EXPECT_EQ( local.numLayers(), shared.numLayers() );
+		// Past 16 keys crowded lanes cap the towers too. The bytes of these
+		// keys XOR to 0xFF, so every coin flip is heads.
+		for(unsigned i = 1; i < 4096; i++)
+		{
+			unsigned k = (i << 8) | ((i & 0xFF) ^ (i >> 8) ^ 0xFF);
+			shared.insert(k, i);
+			local.insert(k, i);
+		}
+		EXPECT_EQ( local.numLayers(), shared.numLayers() );
+		EXPECT_LE( shared.numLayers(), 16 );
+		EXPECT_EQ( local.allKeysInOrder(), shared.allKeysInOrder() );
+	}
+
+	TEST(SharedTests, FullSegmentThrows)
+	{
+		std::string name = segmentName("full");
+		SharedSkipList<unsigned, unsigned> writer(name, 4096);
+		SharedSkipList<unsigned, unsigned>::removeSegment(name);
+		unsigned inserted = 0;
+		EXPECT_THROW(
+		{
+			for(unsigned i = 0; i < 4096; i++)
+			{
+				writer.insert(i, i);
+				++inserted;
+			}
+		}, RuntimeException);
+		EXPECT_EQ( inserted, writer.size() );
+		EXPECT_EQ( inserted - 1, writer.allKeysInOrder().back() );
+	}
+
+	TEST(SharedTests, OpenRejectsOtherTypes)
+	{
+		std::string name = segmentName("types");
+		SharedSkipList<unsigned, unsigned> writer(name, 1 << 16);
+		EXPECT_THROW((SharedSkipList<unsigned, double>(name)), RuntimeException);
+		EXPECT_THROW((SharedSkipList<unsigned, unsigned>(name, 1 << 16)), RuntimeException);
+		SharedSkipList<unsigned, unsigned>::removeSegment(name);
+		EXPECT_THROW((SharedSkipList<unsigned, unsigned>(name)), RuntimeException);
+	}
+
+	TEST(SharedTests, ConcurrentReaderDuringWrites)
+	{
+		std::string name = segmentName("concurrent");
+		SharedSkipList<unsigned, unsigned> writer(name, 1 << 22);
+		SharedSkipList<unsigned, unsigned> reader(name);
+		SharedSkipList<unsigned, unsigned>::removeSegment(name);
+		std::thread readerThread([&reader]()
+		{
+			for(unsigned round = 0; round < 200; round++)
+			{
+				std::vector<unsigned> keys = reader.allKeysInOrder();
+				for(size_t i = 0; i < keys.size(); i++)
+				{
+					ASSERT_EQ( i * 2, keys[i] );
+				}
+				if(!keys.empty())
+				{
+					ASSERT_EQ( keys.back() + 1, reader.find(keys.back()) );
+				}
+			}
+		});
+		for(unsigned i = 0; i < 5000; i++)
+		{
+			writer.insert(i * 2, i * 2 + 1);
+		}
+		readerThread.join();
+	}
+
+	TEST(SharedTests, ReaderInAnotherProcess)
+	{
+		std::string name = segmentName("process");
+		SharedSkipList<int, int> writer(name, 1 << 20);
+		for(int i = -100; i <= 100; i++)
+		{
+			writer.insert(i, -i);
+		}
+		pid_t child = fork();
+		if(child == 0)
+		{
+			int status = 0;
+			try
+			{
+				SharedSkipList<int, int> reader(name);
+				for(int i = -100; i <= 100; i++)
+				{
+					if(reader.find(i) != -i) status = 1;
+				}
+				if(reader.size() != 201 || reader.contains(101)) status = 1;
+			}
+			catch(RuntimeException &)
+			{
+				status = 2;
+			}
+			_exit(status);
+		}
+		int status = -1;
+		waitpid(child, &status, 0);
+		SharedSkipList<int, int>::removeSegment(name);
+		EXPECT_TRUE( WIFEXITED(status) );
+		EXPECT_EQ( 0, WEXITSTATUS(status) );
+	}
+
+	TEST(SharedTests, ReaderGivesUpOnDeadWriter)
+	{
+		std::string name = segmentName("dead");
+		SharedSkipList<unsigned, unsigned> writer(name, 1 << 16);
+		writer.insert(1, 1);
+		SharedSkipList<unsigned, unsigned> reader(name);
+		reader.setWriterTimeout(std::chrono::milliseconds(20));
+		// Leave the version odd, as a writer killed mid-insert would.
+		int fd = shm_open(name.c_str(), O_RDWR, 0);
+		ASSERT_GE( fd, 0 );
+		void* mapped = mmap(nullptr, sizeof(SharedSegmentHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		SharedSkipList<unsigned, unsigned>::removeSegment(name);
+		ASSERT_NE( MAP_FAILED, mapped );
+		SharedSegmentHeader* header = static_cast<SharedSegmentHeader*>(mapped);
+		header->version.fetch_add(1);
+		EXPECT_THROW(reader.find(1), RuntimeException);
+		EXPECT_THROW(reader.allKeysInOrder(), RuntimeException);
+		header->version.fetch_add(1);
+		EXPECT_EQ( 1, reader.find(1) );
+		munmap(mapped, sizeof(SharedSegmentHeader));
+	}
+
+}
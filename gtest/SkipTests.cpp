@@ -1,4 +1,7 @@
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <limits>
+#include <string>
 #include <vector>
 #include "SkipList.hpp"
 
@@ -244,4 +247,594 @@ namespace{
 		
 	}
 
+	TEST(PriorityQueueTests, MinAndMax)
+	{
+		SkipList<int, int> sl;
+		EXPECT_THROW(sl.min(), RuntimeException);
+		EXPECT_THROW(sl.max(), RuntimeException);
+		for(int i = -50; i < 51; i++)
+		{
+			sl.insert(i, i * 2);
+		}
+		EXPECT_TRUE( sl.min() == -50 and sl.max() == 50 );
+	}
+
+	TEST(PriorityQueueTests, PopMinAndPopMax)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned i = 0; i < 100; i++)
+		{
+			sl.insert((i * 37) % 100, i);
+		}
+		std::pair<unsigned, unsigned> smallest = sl.popMin();
+		std::pair<unsigned, unsigned> largest = sl.popMax();
+		EXPECT_EQ( 0, smallest.first );
+		EXPECT_EQ( 0, smallest.second );
+		EXPECT_EQ( 99, largest.first );
+		EXPECT_EQ( 98, sl.size() );
+		EXPECT_TRUE( sl.isSmallestKey(1) and sl.isLargestKey(98) );
+		EXPECT_THROW(sl.find(0), RuntimeException);
+		EXPECT_THROW(sl.find(99), RuntimeException);
+		for(unsigned i = 1; i < 99; i++)
+		{
+			EXPECT_EQ( i, sl.popMin().first );
+		}
+		EXPECT_TRUE( sl.isEmpty() );
+		EXPECT_THROW(sl.popMin(), RuntimeException);
+		EXPECT_THROW(sl.popMax(), RuntimeException);
+		EXPECT_TRUE( sl.insert(42, 42) and sl.find(42) == 42 );
+	}
+
+	TEST(PriorityQueueTests, DrainUntil)
+	{
+		SkipList<std::string, std::string> sl;
+		for(int i = 0; i < 100; ++i)
+		{
+			sl.insert(std::to_string(i+100), std::to_string(i));
+		}
+		std::vector<std::pair<std::string, std::string>> out;
+		EXPECT_EQ( 50, sl.drainUntil("149", out) );
+		EXPECT_EQ( 50, out.size() );
+		EXPECT_TRUE( out.front().first == "100" and out.back().first == "149" );
+		EXPECT_TRUE( out.back().second == "49" );
+		EXPECT_TRUE( sl.min() == "150" and sl.size() == 50 );
+		EXPECT_EQ( 0, sl.drainUntil("000", out) );
+		EXPECT_EQ( 50, sl.drainUntil("999", out) );
+		EXPECT_TRUE( sl.isEmpty() );
+	}
+
+	TEST(PriorityQueueTests, AllHeadsKeysStayLogarithmic)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned i = 0; i < 4096; i++)
+		{
+			// The bytes of these keys XOR to 0xFF, so every coin flip is heads.
+			sl.insert((i << 8) | ((i & 0xFF) ^ (i >> 8) ^ 0xFF), i);
+		}
+		// Without a limit every tower would reach the cap of 3 * 12 + 1 lanes.
+		EXPECT_LE( sl.numLayers(), 16 );
+		EXPECT_EQ( 0, sl.popMin().second );
+		EXPECT_EQ( 4095, sl.popMax().second );
+	}
+
+	TEST(PriorityQueueTests, TowersStopBelowCrowdedLanes)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned i = 1; i <= 16; i++)
+		{
+			// The bytes of these keys XOR to 3: two heads, then tails.
+			sl.insert((i << 8) | (i ^ 3), i);
+			EXPECT_EQ( 3, sl.height((i << 8) | (i ^ 3)) );
+		}
+		// 255 flips heads up to the cap, but lane S_1 already holds every
+		// key of S_0, so its tower stays on S_0.
+		sl.insert(255, 255);
+		EXPECT_EQ( 1, sl.height(255) );
+		EXPECT_EQ( 4, sl.numLayers() );
+	}
+
+	TEST(SpliceTests, SplitAtAndAppend)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned i = 0; i < 200; i++)
+		{
+			sl.insert(i, i + 1000);
+		}
+		SkipList<unsigned, unsigned> upper;
+		sl.splitAt(120, upper);
+		EXPECT_EQ( 120, sl.size() );
+		EXPECT_EQ( 80, upper.size() );
+		EXPECT_TRUE( sl.max() == 119 and upper.min() == 120 );
+		EXPECT_EQ( 1150, upper.find(150) );
+		EXPECT_THROW(sl.find(150), RuntimeException);
+		EXPECT_TRUE( sl.insert(500, 500) );
+		EXPECT_THROW(sl.append(upper), RuntimeException);
+		sl.popMax();
+		sl.append(upper);
+		EXPECT_TRUE( upper.isEmpty() );
+		std::vector<unsigned> expected;
+		for(unsigned i = 0; i < 200; i++)
+		{
+			expected.push_back(i);
+			EXPECT_EQ( i + 1000, sl.find(i) );
+		}
+		EXPECT_TRUE( expected == sl.allKeysInOrder() );
+		EXPECT_TRUE( upper.insert(7, 7) and upper.find(7) == 7 );
+	}
+
+	TEST(SpliceTests, ForEachInRange)
+	{
+		SkipList<int, int> sl;
+		for(int i = -50; i < 51; i++)
+		{
+			sl.insert(i, -i);
+		}
+		std::vector<int> keys;
+		int sum = 0;
+		sl.forEachInRange(-3, 5, [&](const int & k, const int & v)
+		{
+			keys.push_back(k);
+			sum += v;
+		});
+		EXPECT_TRUE( keys == std::vector<int>({-3, -2, -1, 0, 1, 2, 3, 4, 5}) );
+		EXPECT_EQ( -9, sum );
+	}
+
+	TEST(RebalanceTests, RebalanceAssignsIdealHeights)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned i = 0; i < 1000; i++)
+		{
+			// The bytes of these keys XOR to zero, so every coin flip is
+			// tails and the list degenerates into a single lane.
+			sl.insert((i << 8) | ((i & 0xFF) ^ (i >> 8)), i);
+		}
+		EXPECT_TRUE( sl.needsRebalance() );
+		std::vector<unsigned> keys = sl.allKeysInOrder();
+		sl.rebalance();
+		EXPECT_FALSE( sl.needsRebalance() );
+		EXPECT_TRUE( keys == sl.allKeysInOrder() );
+		for(unsigned rank = 1; rank <= keys.size(); rank++)
+		{
+			unsigned expected = 1;
+			for(unsigned r = rank; r % 2 == 0; r /= 2)
+			{
+				++expected;
+			}
+			EXPECT_EQ( expected, sl.height(keys[rank-1]) );
+			EXPECT_EQ( rank - 1, sl.find(keys[rank-1]) );
+		}
+		EXPECT_TRUE( sl.insert(7, 7) and sl.find(7) == 7 );
+	}
+
+	TEST(RebalanceTests, RebalanceStrings)
+	{
+		SkipList<std::string, std::string> sl;
+		for(int i = 0; i < 300; ++i)
+		{
+			sl.insert("key" + std::to_string(i), std::to_string(i));
+		}
+		sl.rebalance();
+		for(int i = 0; i < 300; ++i)
+		{
+			EXPECT_TRUE( sl.find("key" + std::to_string(i)) == std::to_string(i) );
+		}
+		EXPECT_EQ( 300, sl.size() );
+	}
+
+	TEST(RebalanceTests, IncrementalRebalance)
+	{
+		SkipList<unsigned, unsigned> sl;
+		sl.setIncrementalRebalance(4);
+		std::vector<std::pair<unsigned, unsigned>> drained;
+		for(unsigned i = 0; i < 2000; i++)
+		{
+			unsigned k = (i * 7919) % 2000;
+			sl.insert((k << 8) | ((k & 0xFF) ^ (k >> 8)), i);
+			if(i % 97 == 1) sl.popMin();
+			if(i % 89 == 1) sl.popMax();
+			if(i % 500 == 1) sl.drainUntil(100 << 8, drained);
+		}
+		EXPECT_FALSE( sl.needsRebalance() );
+		std::vector<unsigned> keys = sl.allKeysInOrder();
+		EXPECT_EQ( sl.size(), keys.size() );
+		for(size_t i = 1; i < keys.size(); i++)
+		{
+			EXPECT_LT( keys[i-1], keys[i] );
+			EXPECT_EQ( keys[i-1], sl.previousKey(keys[i]) );
+		}
+	}
+
+	TEST(RebalanceTests, MoreThan32Lanes)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned i = 0; i < 100000; i++)
+		{
+			// Every coin flip is heads, so a few towers climb past lane 32.
+			sl.insert((i << 8) | ((i & 0xFF) ^ (i >> 8) ^ 0xFF), i);
+		}
+		EXPECT_GT( sl.numLayers(), 32 );
+		sl.rebalance();
+		EXPECT_FALSE( sl.needsRebalance() );
+		sl.setIncrementalRebalance(4);
+		for(unsigned i = 0; i < 100; i++)
+		{
+			sl.insert(0xFFFFFF00 + i, i);
+		}
+		EXPECT_FALSE( sl.needsRebalance() );
+		EXPECT_EQ( 100100, sl.size() );
+	}
+
+	// Checks aggregate() against a plain walk over every [lo, hi] window.
+	template<typename Aggregate>
+	void expectAggregatesMatch(const SkipList<int, int, Aggregate> & sl, int lo, int hi)
+	{
+		Aggregate aggregator;
+		for(int a = lo; a <= hi; a += 3)
+		{
+			for(int b = a; b <= hi; b += 5)
+			{
+				typename Aggregate::Type expected = aggregator.identity();
+				sl.forEachInRange(a, b, [&](const int &, const int & v)
+				{
+					expected = aggregator.combine(expected, aggregator.lift(v));
+				});
+				EXPECT_EQ( expected, sl.aggregate(a, b) );
+			}
+		}
+	}
+
+	TEST(AggregateTests, SumMinMaxCount)
+	{
+		SkipList<int, int, SumAggregate<int>> sums;
+		SkipList<int, int, MinAggregate<int>> mins;
+		SkipList<int, int, MaxAggregate<int>> maxes;
+		SkipList<int, int, CountAggregate<int>> counts;
+		for(int i = 0; i < 300; i++)
+		{
+			int k = (i * 7919) % 300 - 150;
+			int v = (i * 31) % 97 - 40;
+			sums.insert(k, v);
+			mins.insert(k, v);
+			maxes.insert(k, v);
+			counts.insert(k, v);
+		}
+		EXPECT_EQ( 300, counts.aggregate(-1000, 1000) );
+		EXPECT_EQ( 0, counts.aggregate(10, 9) );
+		EXPECT_EQ( 0, sums.aggregate(500, 600) );
+		expectAggregatesMatch(sums, -160, 160);
+		expectAggregatesMatch(mins, -160, 160);
+		expectAggregatesMatch(maxes, -160, 160);
+		expectAggregatesMatch(counts, -160, 160);
+	}
+
+	TEST(AggregateTests, KeptCurrentByUpdatesAndRemovals)
+	{
+		SkipList<int, int, SumAggregate<int>> sl;
+		for(int i = 0; i < 200; i++)
+		{
+			sl.insert(i, i);
+		}
+		EXPECT_EQ( 199 * 200 / 2, sl.aggregate(0, 199) );
+		sl.update(50, 1050);
+		EXPECT_EQ( 199 * 200 / 2 + 1000, sl.aggregate(0, 199) );
+		EXPECT_EQ( 1050, sl.aggregate(50, 50) );
+		EXPECT_THROW(sl.update(500, 1), RuntimeException);
+		sl.popMin();
+		sl.popMax();
+		std::vector<std::pair<int, int>> drained;
+		sl.drainUntil(9, drained);
+		expectAggregatesMatch(sl, -5, 205);
+		sl.rebalance();
+		expectAggregatesMatch(sl, -5, 205);
+		SkipList<int, int, SumAggregate<int>> upper;
+		sl.splitAt(100, upper);
+		expectAggregatesMatch(sl, -5, 205);
+		expectAggregatesMatch(upper, -5, 205);
+		sl.append(upper);
+		expectAggregatesMatch(sl, -5, 205);
+		EXPECT_EQ( 0, upper.aggregate(0, 1000) );
+	}
+
+	TEST(AggregateTests, IncrementalRebalanceKeepsAggregates)
+	{
+		SkipList<int, int, MaxAggregate<int>> sl;
+		sl.setIncrementalRebalance(3);
+		for(int i = 0; i < 400; i++)
+		{
+			int k = (i * 7919) % 400;
+			sl.insert(k << 8 | ((k & 0xFF) ^ (k >> 8)), (i * 37) % 101);
+		}
+		std::vector<int> keys = sl.allKeysInOrder();
+		for(size_t a = 0; a < keys.size(); a += 17)
+		{
+			for(size_t b = a; b < keys.size(); b += 23)
+			{
+				int expected = MaxAggregate<int>().identity();
+				for(size_t i = a; i <= b; i++)
+				{
+					expected = std::max(expected, sl.find(keys[i]));
+				}
+				EXPECT_EQ( expected, sl.aggregate(keys[a], keys[b]) );
+			}
+		}
+	}
+
+	TEST(HashIndexTests, LookupsMatchTheLanes)
+	{
+		SkipList<unsigned, unsigned> plain;
+		SkipList<unsigned, unsigned> hashed;
+		hashed.enableHashIndex();
+		EXPECT_TRUE(hashed.hasHashIndex());
+		EXPECT_FALSE(plain.hasHashIndex());
+		for(unsigned i = 0; i < 500; i++)
+		{
+			unsigned k = (i * 7919) % 1000;
+			EXPECT_EQ( plain.insert(k, i), hashed.insert(k, i) );
+		}
+		EXPECT_FALSE(hashed.insert(0, 1));
+		EXPECT_EQ( plain.size(), hashed.size() );
+		for(unsigned k = 0; k < 1000; k++)
+		{
+			EXPECT_EQ( plain.contains(k), hashed.contains(k) );
+			if(!plain.contains(k)) continue;
+			EXPECT_EQ( plain.find(k), hashed.find(k) );
+			EXPECT_EQ( plain.height(k), hashed.height(k) );
+			if(!plain.isLargestKey(k))
+			{
+				EXPECT_EQ( plain.nextKey(k), hashed.nextKey(k) );
+			}
+			if(!plain.isSmallestKey(k))
+			{
+				EXPECT_EQ( plain.previousKey(k), hashed.previousKey(k) );
+			}
+		}
+		EXPECT_THROW(hashed.find(1001), RuntimeException);
+		EXPECT_THROW(hashed.nextKey(hashed.max()), RuntimeException);
+		EXPECT_THROW(hashed.previousKey(hashed.min()), RuntimeException);
+		EXPECT_GT( hashed.memoryUsage(), plain.memoryUsage() );
+		hashed.enableHashIndex(false);
+		EXPECT_EQ( plain.memoryUsage(), hashed.memoryUsage() );
+	}
+
+	TEST(HashIndexTests, KeptInSyncByRemovalsAndSplices)
+	{
+		SkipList<std::string, int> sl;
+		for(int i = 0; i < 300; i++)
+		{
+			sl.insert(std::to_string(i), i);
+		}
+		sl.enableHashIndex();
+		EXPECT_EQ( "0", sl.popMin().first );
+		std::vector<std::pair<std::string, int>> drained;
+		sl.drainUntil("19", drained);
+		EXPECT_FALSE(sl.contains("0"));
+		EXPECT_FALSE(sl.contains("1"));
+		EXPECT_FALSE(sl.contains("19"));
+		EXPECT_TRUE(sl.contains("2"));
+		SkipList<std::string, int> upper;
+		upper.enableHashIndex();
+		sl.splitAt("5", upper);
+		EXPECT_FALSE(sl.contains("50"));
+		EXPECT_TRUE(upper.contains("50"));
+		EXPECT_EQ( 50, upper.find("50") );
+		EXPECT_TRUE(sl.contains("49"));
+		sl.append(upper);
+		EXPECT_FALSE(upper.contains("50"));
+		EXPECT_EQ( 50, sl.find("50") );
+		for(const std::string & k : sl.allKeysInOrder())
+		{
+			EXPECT_EQ( std::stoi(k), sl.find(k) );
+		}
+		while(!sl.isEmpty())
+		{
+			std::string k = sl.popMax().first;
+			EXPECT_FALSE(sl.contains(k));
+		}
+		EXPECT_TRUE(sl.insert("7", 7));
+		EXPECT_EQ( 7, sl.find("7") );
+	}
+
+	TEST(SentinelTests, SentinelKeysAreNotStored)
+	{
+		SkipList<unsigned, unsigned> numbers;
+		SkipList<std::string, unsigned> strings;
+		for(unsigned i = 0; i < 100; i++)
+		{
+			numbers.insert(i, i);
+			strings.insert(std::to_string(i), i);
+		}
+		EXPECT_FALSE( numbers.contains(std::numeric_limits<unsigned>::max()) );
+		EXPECT_FALSE( numbers.remove(std::numeric_limits<unsigned>::max()) );
+		EXPECT_THROW(numbers.find(std::numeric_limits<unsigned>::max()), RuntimeException);
+		EXPECT_FALSE( strings.contains("") );
+		EXPECT_FALSE( strings.remove("") );
+		EXPECT_THROW(strings.find(""), RuntimeException);
+		EXPECT_EQ( 100, numbers.size() );
+		EXPECT_EQ( 100, strings.size() );
+		EXPECT_TRUE( numbers.isLargestKey(99) );
+	}
+
+	TEST(BatchInsertTests, MergesIntoExistingList)
+	{
+		SkipList<unsigned, unsigned> sl;
+		for(unsigned i = 0; i < 300; i++)
+		{
+			sl.insert(i * 10, i);
+		}
+		std::vector<std::pair<unsigned, unsigned>> batch;
+		for(unsigned k = 5; k < 4000; k += 5)
+		{
+			batch.emplace_back(k, k + 1);
+			if(k % 100 == 0) batch.emplace_back(k, 0);
+		}
+		EXPECT_EQ( 500, sl.insertSortedBatch(batch.begin(), batch.end()) );
+		std::vector<unsigned> keys = sl.allKeysInOrder();
+		EXPECT_EQ( keys.size(), sl.size() );
+		EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+		EXPECT_EQ( 800, keys.size() );
+		for(unsigned k : keys)
+		{
+			// Existing keys keep their values; new ones take the batch's.
+			EXPECT_EQ( k % 10 == 0 && k < 3000 ? k / 10 : k + 1, sl.find(k) );
+			EXPECT_LT( sl.height(k), sl.numLayers() );
+		}
+		EXPECT_EQ( 0, sl.insertSortedBatch(batch.begin(), batch.begin()) );
+	}
+
+	TEST(BatchInsertTests, RejectsUnsortedBatches)
+	{
+		SkipList<int, int> sl;
+		sl.insert(1, 1);
+		std::vector<std::pair<int, int>> batch = { {2, 2}, {4, 4}, {3, 3} };
+		EXPECT_THROW(sl.insertSortedBatch(batch.begin(), batch.end()), RuntimeException);
+		EXPECT_EQ( 1, sl.size() );
+	}
+
+	TEST(BatchInsertTests, KeepsAggregatesAndIndexCurrent)
+	{
+		SkipList<int, int, SumAggregate<int>> sl;
+		sl.enableHashIndex();
+		for(int i = 0; i < 1000; i += 2)
+		{
+			sl.insert(i, i);
+		}
+		std::vector<std::pair<int, int>> small = { {-3, -3}, {101, 101}, {555, 555}, {2001, 2001} };
+		EXPECT_EQ( 4, sl.insertSortedBatch(small.begin(), small.end()) );
+		expectAggregatesMatch(sl, -5, 2005);
+		std::vector<std::pair<int, int>> large;
+		for(int i = 1; i < 1000; i += 2)
+		{
+			large.emplace_back(i, i);
+		}
+		sl.insertSortedBatch(large.begin(), large.end());
+		expectAggregatesMatch(sl, -5, 2005);
+		EXPECT_EQ( 999 * 1000 / 2 - 3 + 2001, sl.aggregate(-10, 3000) );
+		for(int i = 0; i < 1000; i++)
+		{
+			EXPECT_TRUE(sl.contains(i));
+		}
+		EXPECT_TRUE(sl.contains(2001));
+	}
+
+	TEST(InlineTests, SmallListsMatchTowerLists)
+	{
+		SkipList<unsigned, unsigned> small;
+		SkipList<unsigned, unsigned> towers;
+		towers.enableHashIndex();
+		towers.enableHashIndex(false);
+		for(unsigned i = 0; i < 16; i++)
+		{
+			unsigned k = (i * 37) % 64;
+			EXPECT_TRUE(small.insert(k, i));
+			towers.insert(k, i);
+		}
+		EXPECT_FALSE(small.insert(0, 5));
+		EXPECT_EQ( towers.numLayers(), small.numLayers() );
+		EXPECT_EQ( towers.allKeysInOrder(), small.allKeysInOrder() );
+		for(unsigned k : towers.allKeysInOrder())
+		{
+			EXPECT_EQ( towers.height(k), small.height(k) );
+			EXPECT_EQ( towers.find(k), small.find(k) );
+			EXPECT_EQ( towers.isSmallestKey(k), small.isSmallestKey(k) );
+			EXPECT_EQ( towers.isLargestKey(k), small.isLargestKey(k) );
+			if(!towers.isLargestKey(k))
+			{
+				EXPECT_EQ( towers.nextKey(k), small.nextKey(k) );
+			}
+		}
+		EXPECT_THROW(small.find(1), RuntimeException);
+		EXPECT_THROW(small.previousKey(small.min()), RuntimeException);
+		EXPECT_LT( small.memoryUsage(), towers.memoryUsage() );
+		// The seventeenth key moves everything into towers.
+		EXPECT_TRUE(small.insert(1, 1));
+		EXPECT_TRUE(towers.insert(1, 1));
+		EXPECT_EQ( towers.numLayers(), small.numLayers() );
+		for(unsigned k : towers.allKeysInOrder())
+		{
+			EXPECT_EQ( towers.height(k), small.height(k) );
+		}
+	}
+
+	TEST(InlineTests, RemovalsCursorsAndRanges)
+	{
+		SkipList<int, int, SumAggregate<int>> sl;
+		for(int i = 10; i > 0; i--)
+		{
+			sl.insert(i, i * 10);
+		}
+		EXPECT_EQ( 550, sl.aggregate(0, 100) );
+		EXPECT_EQ( 70, sl.aggregate(3, 4) );
+		sl.update(4, 0);
+		EXPECT_EQ( 30, sl.aggregate(3, 4) );
+		EXPECT_EQ( 1, sl.popMin().first );
+		EXPECT_EQ( 10, sl.popMax().first );
+		EXPECT_TRUE(sl.remove(5));
+		EXPECT_FALSE(sl.remove(5));
+		std::vector<std::pair<int, int>> drained;
+		EXPECT_EQ( 2, sl.drainUntil(3, drained) );
+		EXPECT_EQ( std::vector<int>({4, 6, 7, 8, 9}), sl.allKeysInOrder() );
+		SkipList<int, int, SumAggregate<int>>::Cursor c = sl.cursor();
+		c.seek(7);
+		EXPECT_EQ( 7, c.key() );
+		c.next();
+		EXPECT_EQ( 80, c.value() );
+		c.seek(100);
+		EXPECT_TRUE(c.atEnd());
+		std::vector<int> visited;
+		sl.forEachInRange(5, 8, [&visited](int k, int) { visited.push_back(k); });
+		EXPECT_EQ( std::vector<int>({6, 7, 8}), visited );
+		SkipList<int, int, SumAggregate<int>> upper;
+		sl.splitAt(7, upper);
+		EXPECT_EQ( std::vector<int>({4, 6}), sl.allKeysInOrder() );
+		EXPECT_EQ( std::vector<int>({7, 8, 9}), upper.allKeysInOrder() );
+		sl.append(upper);
+		EXPECT_TRUE(upper.isEmpty());
+		EXPECT_EQ( 5, sl.size() );
+		std::vector<std::pair<int, int>> batch;
+		for(int i = 20; i < 40; i++)
+		{
+			batch.emplace_back(i, 1);
+		}
+		EXPECT_EQ( 20, sl.insertSortedBatch(batch.begin(), batch.end()) );
+		expectAggregatesMatch(sl, 0, 50);
+		EXPECT_EQ( 300 + 20, sl.aggregate(0, 50) );
+	}
+
+	TEST(InlineTests, DrainingNothingKeepsStringKeys)
+	{
+		SkipList<std::string, int> sl;
+		sl.insert("b", 1);
+		sl.insert("c", 2);
+		std::vector<std::pair<std::string, int>> drained;
+		EXPECT_EQ( 0, sl.drainUntil("a", drained) );
+		EXPECT_TRUE(drained.empty());
+		EXPECT_EQ( std::vector<std::string>({"b", "c"}), sl.allKeysInOrder() );
+		EXPECT_EQ( 1, sl.find("b") );
+		EXPECT_EQ( 2, sl.find("c") );
+	}
+
+	TEST(InlineTests, StringListsPromotePastTheirSlots)
+	{
+		SkipList<std::string, std::string> sl;
+		EXPECT_LE( sizeof(sl), 2 * sizeof(SkipList<unsigned, unsigned>) );
+		std::vector<std::string> keys;
+		for(unsigned i = 0; i < 12; i++)
+		{
+			std::string k = "session/" + std::to_string((i * 5) % 12) + std::string(20, 'x');
+			keys.push_back(k);
+			EXPECT_TRUE(sl.insert(k, k + "=value"));
+			EXPECT_EQ( i + 1, sl.size() );
+		}
+		std::sort(keys.begin(), keys.end());
+		EXPECT_EQ( keys, sl.allKeysInOrder() );
+		for(const std::string & k : keys)
+		{
+			EXPECT_EQ( k + "=value", sl.find(k) );
+		}
+		EXPECT_TRUE(sl.remove(keys[3]));
+		EXPECT_FALSE(sl.contains(keys[3]));
+		EXPECT_EQ( 11, sl.size() );
+	}
+
 }